@@ -0,0 +1,694 @@
+#include "CommandLineTools.h"
+#include "SynthEngine.h"
+#include "SessionCapture.h"
+#include "PluginProcessor.h"
+#include "MPEOutput.h"
+#include "PerformanceMode.h"
+
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+    juce::String getOptionValue(const juce::StringArray& args, const juce::String& option)
+    {
+        auto index = args.indexOf(option);
+        return index >= 0 ? args[index + 1].unquoted() : juce::String();
+    }
+
+    int getIntOption(const juce::StringArray& args, const juce::String& option, int defaultValue)
+    {
+        auto value = getOptionValue(args, option);
+        return value.isNotEmpty() ? juce::jmax(1, value.getIntValue()) : defaultValue;
+    }
+
+    juce::String describeCosts(std::vector<double> micros, double budgetMicros)
+    {
+        std::sort(micros.begin(), micros.end());
+
+        auto mean = std::accumulate(micros.begin(), micros.end(), 0.0) / (double)micros.size();
+        auto percentile = [&micros](double p) { return micros[(size_t)(p * (double)(micros.size() - 1))]; };
+
+        return "mean " + juce::String(mean, 2)
+             + " us, p50 " + juce::String(percentile(0.5), 2)
+             + " us, p99 " + juce::String(percentile(0.99), 2)
+             + " us, max " + juce::String(micros.back(), 2)
+             + " us (block budget " + juce::String(budgetMicros, 2) + " us)";
+    }
+
+    // A grid note in the Launchpad's XY layout, row 0 being the top row
+    int gridNote(int row, int column)
+    {
+        return row * 16 + column;
+    }
+
+    int benchmarkPlugin(const juce::StringArray& args)
+    {
+        auto blockSize = getIntOption(args, "--block-size", 64);
+        auto numBlocks = getIntOption(args, "--blocks", 20000);
+
+        const double sampleRate = 48000.0;
+
+        JISynthAudioProcessor processor;
+        processor.setPlayConfigDetails(0, 2, sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        auto* melNum = processor.getParameters().getParameter("melNum");
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(1024);
+
+        std::vector<double> costs;
+        costs.reserve((size_t)numBlocks);
+
+        juce::Random random(1);
+        int chord[3] = { -1, -1, -1 };
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            midi.clear();
+
+            // a new three note chord every 50 blocks, and the melody ratio automated every 100
+            if (block % 50 == 0)
+            {
+                for (auto& note : chord)
+                {
+                    auto position = random.nextInt(blockSize);
+
+                    if (note >= 0)
+                        midi.addEvent(juce::MidiMessage::noteOff(1, note), position);
+
+                    note = gridNote(random.nextInt(8), random.nextInt(8));
+                    midi.addEvent(juce::MidiMessage::noteOn(1, note, 0.3f), position);
+                }
+            }
+
+            if (block % 100 == 0)
+                melNum->setValueNotifyingHost(melNum->convertTo0to1((float)(1 + (block / 100) % 8)));
+
+            auto startTicks = juce::Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midi);
+            auto endTicks = juce::Time::getHighResolutionTicks();
+
+            costs.push_back(juce::Time::highResolutionTicksToSeconds(endTicks - startTicks) * 1.0e6);
+        }
+
+        processor.releaseResources();
+
+        std::cout << "Processed " << numBlocks << " blocks of " << blockSize << " samples at "
+                  << sampleRate << " Hz, latency " << processor.getLatencySamples() << " samples" << std::endl
+                  << "processBlock: " << describeCosts(costs, blockSize * 1.0e6 / sampleRate) << std::endl;
+
+        return 0;
+    }
+
+    std::vector<double> timeBlocks(SynthAudioSource& source, juce::AudioBuffer<float>& buffer, int numBlocks)
+    {
+        juce::MidiBuffer noMidi;
+        juce::AudioSourceChannelInfo info(&buffer, 0, buffer.getNumSamples());
+
+        std::vector<double> costs;
+        costs.reserve((size_t)numBlocks);
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            auto startTicks = juce::Time::getHighResolutionTicks();
+            source.renderBlock(info, noMidi);
+            auto endTicks = juce::Time::getHighResolutionTicks();
+
+            costs.push_back(juce::Time::highResolutionTicksToSeconds(endTicks - startTicks) * 1.0e6);
+        }
+
+        return costs;
+    }
+
+    int benchmarkIdle(const juce::StringArray& args)
+    {
+        auto blockSize = getIntOption(args, "--block-size", 64);
+        auto numBlocks = getIntOption(args, "--blocks", 20000);
+
+        const double sampleRate = 48000.0;
+        auto budgetMicros = blockSize * 1.0e6 / sampleRate;
+
+        juce::MidiKeyboardState keyboardState;
+        SynthAudioSource synthAudioSource(keyboardState);
+        synthAudioSource.prepareToPlay(blockSize, sampleRate);
+        auto rootFreq = juce::MidiMessage::getMidiNoteInHertz(48);
+        synthAudioSource.setJIFrequencies(rootFreq, rootFreq, rootFreq * 1.5);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::AudioSourceChannelInfo info(&buffer, 0, blockSize);
+
+        std::cout << "Idle:         " << describeCosts(timeBlocks(synthAudioSource, buffer, numBlocks), budgetMicros) << std::endl;
+
+        juce::MidiBuffer midi;
+        const int notes[] = { gridNote(7, 1), gridNote(6, 2), gridNote(5, 3), gridNote(4, 4) };
+
+        for (auto note : notes)
+            midi.addEvent(juce::MidiMessage::noteOn(1, note, 0.3f), 0);
+
+        synthAudioSource.renderBlock(info, midi);
+
+        std::cout << "4 voices:     " << describeCosts(timeBlocks(synthAudioSource, buffer, numBlocks), budgetMicros) << std::endl;
+
+        midi.clear();
+
+        for (auto note : notes)
+            midi.addEvent(juce::MidiMessage::noteOff(1, note), 0);
+
+        // count samples from the note-offs until the last voice has finished its tail
+        int samplesToSilence = 0, lastAudibleSample = 0;
+
+        for (auto block = 0; block == 0 || !synthAudioSource.isIdle(); ++block)
+        {
+            synthAudioSource.renderBlock(info, midi);
+            midi.clear();
+
+            for (int i = 0; i < blockSize; ++i)
+                if (buffer.getSample(0, i) != 0.0f)
+                    lastAudibleSample = samplesToSilence + i + 1;
+
+            samplesToSilence += blockSize;
+        }
+
+        std::cout << "Release to silence: " << juce::String(lastAudibleSample * 1000.0 / sampleRate, 2)
+                  << " ms of audio, voices idle after " << juce::String(samplesToSilence * 1000.0 / sampleRate, 2)
+                  << " ms" << std::endl;
+
+        std::cout << "Idle after release: " << describeCosts(timeBlocks(synthAudioSource, buffer, numBlocks), budgetMicros) << std::endl;
+
+        return 0;
+    }
+
+    // the note a layout plays on each pad of the 8x8 grid, indexed by y * 8 + x
+    std::array<int, 64> findPadNotes(const GridLayout& layout)
+    {
+        std::array<int, 64> notes;
+        notes.fill(-1);
+
+        for (int note = 0; note < 128; ++note)
+        {
+            auto point = layout.getPointForNote(note);
+
+            if (point.onGrid && point.x >= 0 && point.x < 8 && point.y >= 0 && point.y < 8
+                && notes[(size_t)(point.y * 8 + point.x)] < 0)
+                notes[(size_t)(point.y * 8 + point.x)] = note;
+        }
+
+        jassert(std::find(notes.begin(), notes.end(), -1) == notes.end());
+        return notes;
+    }
+
+    int benchmarkLayouts(const juce::StringArray& args)
+    {
+        auto blockSize = getIntOption(args, "--block-size", 64);
+        auto numBlocks = getIntOption(args, "--blocks", 20000);
+
+        const double sampleRate = 48000.0;
+        const int numStarts = 1000000;
+        auto rootFreq = juce::MidiMessage::getMidiNoteInHertz(48);
+        TuningValues tuning { rootFreq, rootFreq, rootFreq * 1.5 };
+
+        // every run plays the same pads, so each layout starts a sounding note every time
+        auto& layouts = GridLayouts::getAll();
+        std::vector<std::array<int, 64>> padNotes;
+
+        for (auto* layout : layouts)
+            padNotes.push_back(findPadNotes(*layout));
+
+        // startNote on its own: whatever the layout, it is one table lookup
+        NoteFrequencies frequencies {};
+        juce::uint32 activeVoices = 0;
+        SineWaveVoice voice(frequencies, activeVoices, 1);
+        voice.setCurrentPlaybackSampleRate(sampleRate);
+
+        for (int index = 0; index < layouts.size(); ++index)
+        {
+            auto& notes = padNotes[(size_t)index];
+            layouts[index]->computeFrequencies(tuning, frequencies);
+
+            auto startTicks = juce::Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numStarts; ++i)
+                voice.startNote(notes[(size_t)(i & 63)], 0.5f, nullptr, 0);
+
+            auto endTicks = juce::Time::getHighResolutionTicks();
+
+            std::cout << "startNote, " << layouts[index]->getName() << ": "
+                      << juce::String(juce::Time::highResolutionTicksToSeconds(endTicks - startTicks) * 1.0e9 / numStarts, 2)
+                      << " ns" << std::endl;
+        }
+
+        // the first startNote after a swap, timed apart from the table rebuild the swap causes.
+        // Both runs time single calls, so the timer's own overhead is the same in each.
+        for (auto swapEveryNote : { false, true })
+        {
+            const int numSwaps = 100000;
+            double rebuildSeconds = 0.0, startSeconds = 0.0;
+            auto index = 0;
+
+            layouts[index]->computeFrequencies(tuning, frequencies);
+
+            for (int i = 0; i < numSwaps; ++i)
+            {
+                if (swapEveryNote)
+                {
+                    index = (index + 1) % layouts.size();
+
+                    auto rebuildTicks = juce::Time::getHighResolutionTicks();
+                    layouts[index]->computeFrequencies(tuning, frequencies);
+                    rebuildSeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - rebuildTicks);
+                }
+
+                auto startTicks = juce::Time::getHighResolutionTicks();
+                voice.startNote(padNotes[(size_t)index][(size_t)(i & 63)], 0.5f, nullptr, 0);
+                startSeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            }
+
+            std::cout << (swapEveryNote ? "startNote right after a swap: " : "startNote, same layout:       ")
+                      << juce::String(startSeconds * 1.0e9 / numSwaps, 2) << " ns";
+
+            if (swapEveryNote)
+                std::cout << " (table rebuild " << juce::String(rebuildSeconds * 1.0e6 / numSwaps, 2) << " us)";
+
+            std::cout << std::endl;
+        }
+
+        // whole blocks with a note starting in each, keeping one layout or swapping it every block
+        for (auto swapEveryBlock : { false, true })
+        {
+            juce::MidiKeyboardState keyboardState;
+            SynthAudioSource synthAudioSource(keyboardState);
+            synthAudioSource.prepareToPlay(blockSize, sampleRate);
+            synthAudioSource.setJIFrequencies(tuning.rootFreq, tuning.bassFreq, tuning.melFreq);
+
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            juce::AudioSourceChannelInfo info(&buffer, 0, blockSize);
+            juce::MidiBuffer midi;
+            midi.ensureSize(256);
+
+            std::vector<double> costs;
+            costs.reserve((size_t)numBlocks);
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                auto index = swapEveryBlock ? block % layouts.size() : 0;
+
+                if (swapEveryBlock)
+                    synthAudioSource.setGridLayout(*layouts[index]);
+
+                auto note = padNotes[(size_t)index][(size_t)(block % 64)];
+
+                midi.clear();
+                midi.addEvent(juce::MidiMessage::noteOn(1, note, 0.3f), 0);
+                midi.addEvent(juce::MidiMessage::noteOff(1, note), blockSize / 2);
+
+                auto startTicks = juce::Time::getHighResolutionTicks();
+                synthAudioSource.renderBlock(info, midi);
+                auto endTicks = juce::Time::getHighResolutionTicks();
+
+                costs.push_back(juce::Time::highResolutionTicksToSeconds(endTicks - startTicks) * 1.0e6);
+            }
+
+            std::cout << (swapEveryBlock ? "Layout swapped every block: " : "Fixed layout:               ")
+                      << describeCosts(costs, blockSize * 1.0e6 / sampleRate) << std::endl;
+        }
+
+        return 0;
+    }
+
+    // what a note number plus a 14-bit bend over the MPE member channel bend range sounds like
+    double frequencyForBentNote(int noteNumber, int pitchBend)
+    {
+        auto semitones = noteNumber + (pitchBend - 8192) * (double)MPEOutput::pitchBendRange / 8192.0;
+        return 440.0 * std::pow(2.0, (semitones - 69.0) / 12.0);
+    }
+
+    // Plays every note through a SynthAudioSource with an MPEOutput attached, decodes the
+    // messages the output would send and compares them with the frequencies the voices got
+    int checkMPEPitch()
+    {
+        // a 14-bit bend over +/-48 semitones steps by 4800 / 8192 = 0.586 cents, so rounding
+        // to the nearest step is off by at most 0.293 cents
+        const double maxAllowedCents = 0.3;
+
+        const double sampleRate = 48000.0;
+        const int blockSize = 64;
+        auto rootFreq = juce::MidiMessage::getMidiNoteInHertz(48);
+        const std::pair<int, int> ratios[] = { { 1, 1 }, { 3, 2 }, { 5, 4 }, { 7, 4 }, { 8, 5 }, { 11, 8 }, { 13, 12 } };
+
+        juce::MidiKeyboardState keyboardState;
+        SynthAudioSource synthAudioSource(keyboardState);
+        synthAudioSource.prepareToPlay(blockSize, sampleRate);
+
+        MPEOutput mpeOutput;
+        mpeOutput.enableWithoutDevice();
+        synthAudioSource.setMPEOutput(&mpeOutput);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::AudioSourceChannelInfo info(&buffer, 0, blockSize);
+        juce::MidiBuffer midi, sent;
+
+        double worstCents = 0.0;
+        juce::String worstCase;
+        int numChecked = 0, numOutOfRange = 0;
+        juce::StringArray errors;
+
+        // per MIDI channel: the last bend sent, and the output note held or -1
+        int bendForChannel[17] = {};
+        int noteOnChannel[17];
+        std::fill(std::begin(noteOnChannel), std::end(noteOnChannel), -1);
+
+        for (auto* layout : GridLayouts::getAll())
+        {
+            synthAudioSource.setGridLayout(*layout);
+
+            for (auto& bass : ratios)
+            {
+                for (auto& mel : ratios)
+                {
+                    auto bassFreq = rootFreq * bass.first / bass.second;
+                    synthAudioSource.setJIFrequencies(rootFreq, bassFreq, bassFreq * mel.first / mel.second);
+
+                    auto describe = [&](int note) {
+                        return juce::String(layout->getName()) + ", bass " + juce::String(bass.first) + "/" + juce::String(bass.second)
+                             + ", melody " + juce::String(mel.first) + "/" + juce::String(mel.second) + ", note " + juce::String(note);
+                    };
+
+                    // as many notes at a time as there are voices, so none is stolen
+                    for (int firstNote = 0; firstNote < 128; firstNote += SynthAudioSource::numVoices)
+                    {
+                        auto endNote = juce::jmin(128, firstNote + SynthAudioSource::numVoices);
+
+                        midi.clear();
+
+                        for (int note = firstNote; note < endNote; ++note)
+                            midi.addEvent(juce::MidiMessage::noteOn(1, note, 0.3f), 0);
+
+                        synthAudioSource.renderBlock(info, midi);
+
+                        sent.clear();
+                        mpeOutput.popQueuedMessages(sent);
+
+                        // a bend and a note-on for every note that got a frequency, in the order they came in
+                        auto note = firstNote;
+
+                        for (const auto metadata : sent)
+                        {
+                            auto message = metadata.getMessage();
+                            auto channel = message.getChannel();
+
+                            if (channel < 2 || channel > 16)
+                            {
+                                errors.add(describe(note) + ": sent on channel " + juce::String(channel) + ", not a member channel");
+                                continue;
+                            }
+
+                            if (message.isPitchWheel())
+                            {
+                                bendForChannel[channel] = message.getPitchWheelValue();
+                                continue;
+                            }
+
+                            if (!message.isNoteOn())
+                            {
+                                errors.add(describe(note) + ": unexpected " + message.getDescription());
+                                continue;
+                            }
+
+                            // notes the engine left silent are skipped by the output too
+                            while (note < endNote && synthAudioSource.getVoiceFrequency(note) <= 0.0)
+                                ++note;
+
+                            if (note == endNote)
+                            {
+                                errors.add(describe(firstNote) + ": note-on sent without a sounding voice");
+                                break;
+                            }
+
+                            if (noteOnChannel[channel] >= 0)
+                                errors.add(describe(note) + ": channel " + juce::String(channel) + " is already playing a note");
+
+                            noteOnChannel[channel] = message.getNoteNumber();
+
+                            auto voiceFreq = synthAudioSource.getVoiceFrequency(note);
+                            auto bend = bendForChannel[channel];
+                            ++note;
+
+                            // beyond what a MIDI note plus the full bend range can reach
+                            if (bend == 0 || bend == 16383)
+                            {
+                                ++numOutOfRange;
+                                continue;
+                            }
+
+                            auto cents = std::abs(1200.0 * std::log2(frequencyForBentNote(message.getNoteNumber(), bend) / voiceFreq));
+                            ++numChecked;
+
+                            if (cents > worstCents)
+                            {
+                                worstCents = cents;
+                                worstCase = describe(note - 1) + " (" + juce::String(voiceFreq, 3) + " Hz)";
+                            }
+                        }
+
+                        for (; note < endNote; ++note)
+                            if (synthAudioSource.getVoiceFrequency(note) > 0.0)
+                                errors.add(describe(note) + ": sounding voice but no MPE note-on");
+
+                        // every note-off has to reach the channel and output note of its note-on
+                        midi.clear();
+
+                        for (int n = firstNote; n < endNote; ++n)
+                            midi.addEvent(juce::MidiMessage::noteOff(1, n), 0);
+
+                        synthAudioSource.renderBlock(info, midi);
+
+                        sent.clear();
+                        mpeOutput.popQueuedMessages(sent);
+
+                        for (const auto metadata : sent)
+                        {
+                            auto message = metadata.getMessage();
+                            auto channel = juce::jlimit(0, 16, message.getChannel());
+
+                            if (!message.isNoteOff() || noteOnChannel[channel] != message.getNoteNumber())
+                                errors.add(describe(firstNote) + ": unmatched " + message.getDescription());
+                            else
+                                noteOnChannel[channel] = -1;
+                        }
+
+                        for (int channel = 0; channel <= 16; ++channel)
+                        {
+                            if (noteOnChannel[channel] >= 0)
+                            {
+                                errors.add(describe(firstNote) + ": note " + juce::String(noteOnChannel[channel])
+                                           + " left hanging on channel " + juce::String(channel));
+                                noteOnChannel[channel] = -1;
+                            }
+                        }
+
+                        // let the tails finish, so the next notes start on free voices
+                        midi.clear();
+
+                        while (!synthAudioSource.isIdle())
+                            synthAudioSource.renderBlock(info, midi);
+                    }
+                }
+            }
+        }
+
+        if (mpeOutput.getNumDroppedNotes() > 0)
+            errors.add(juce::String(mpeOutput.getNumDroppedNotes()) + " MPE messages dropped");
+
+        std::cout << "Checked " << numChecked << " notes sent by the MPE output against the engine's voices, "
+                  << numOutOfRange << " out of MPE range" << std::endl
+                  << "Worst error: " << juce::String(worstCents, 4) << " cents, " << worstCase << std::endl;
+
+        for (int i = 0; i < juce::jmin(10, errors.size()); ++i)
+            std::cerr << errors[i] << std::endl;
+
+        if (errors.size() > 10)
+            std::cerr << "... and " << errors.size() - 10 << " more" << std::endl;
+
+        if (!errors.isEmpty() || numChecked == 0)
+        {
+            std::cerr << "MPE output doesn't match the engine" << std::endl;
+            return 1;
+        }
+
+        if (worstCents > maxAllowedCents)
+        {
+            std::cerr << "MPE pitch error exceeds " << maxAllowedCents << " cents" << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    // runs the synth on the device the way MainComponent does, with the monitor around it
+    class MonitoredSynthSource : public juce::AudioSource
+    {
+    public:
+        MonitoredSynthSource(SynthAudioSource& synthToUse, PerformanceMonitor& monitorToUse)
+            : synth(synthToUse), monitor(monitorToUse) {}
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override
+        {
+            synth.prepareToPlay(samplesPerBlockExpected, sampleRate);
+            monitor.prepareToPlay(sampleRate);
+        }
+
+        void releaseResources() override { synth.releaseResources(); }
+
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+        {
+            monitor.processInput(bufferToFill);
+            synth.getNextAudioBlock(bufferToFill);
+            monitor.processOutput(bufferToFill);
+        }
+
+    private:
+        SynthAudioSource& synth;
+        PerformanceMonitor& monitor;
+    };
+
+    int checkPerformance(const juce::StringArray& args)
+    {
+        auto settings = PerformanceSettings::fromCommandLine(args);
+        auto seconds = getIntOption(args, "--seconds", 10);
+
+        juce::AudioDeviceManager deviceManager;
+        auto error = deviceManager.initialise(settings.measureLatency ? 1 : 0, 2, nullptr, false);
+
+        if (error.isNotEmpty())
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+
+        juce::MidiKeyboardState keyboardState;
+        SynthAudioSource synthAudioSource(keyboardState);
+        auto rootFreq = juce::MidiMessage::getMidiNoteInHertz(48);
+        synthAudioSource.setJIFrequencies(rootFreq, rootFreq, rootFreq * 1.5);
+
+        PerformanceMonitor monitor(deviceManager, settings);
+        MonitoredSynthSource source(synthAudioSource, monitor);
+        juce::AudioSourcePlayer player;
+        player.setSource(&source);
+        deviceManager.addAudioCallback(&player);
+
+        error = monitor.start();
+
+        if (error.isNotEmpty())
+        {
+            deviceManager.removeAudioCallback(&player);
+            std::cerr << "Performance mode: " << error << std::endl;
+            return 1;
+        }
+
+        const int notes[] = { gridNote(7, 1), gridNote(6, 2), gridNote(5, 3) };
+
+        for (auto note : notes)
+            keyboardState.noteOn(1, note, 0.3f);
+
+        juce::Thread::sleep(seconds * 1000);
+
+        for (auto note : notes)
+            keyboardState.noteOff(1, note, 0.0f);
+
+        juce::Thread::sleep(100);
+
+        auto* device = deviceManager.getCurrentAudioDevice();
+        auto xruns = device != nullptr ? device->getXRunCount() : -1;
+
+        std::cout << monitor.createReport() << std::endl;
+
+        deviceManager.removeAudioCallback(&player);
+        player.setSource(nullptr);
+        deviceManager.closeAudioDevice();
+
+        return monitor.isAudioThreadRealtime() && xruns <= 0 ? 0 : 1;
+    }
+
+    int replaySession(const juce::StringArray& args)
+    {
+        juce::File logFile(juce::File::getCurrentWorkingDirectory().getChildFile(getOptionValue(args, "--replay")));
+
+        if (!logFile.existsAsFile())
+        {
+            std::cerr << "No session log at " << logFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        juce::MidiKeyboardState keyboardState;
+        SynthAudioSource synthAudioSource(keyboardState);
+
+        SessionReplayer replayer(logFile);
+        auto result = replayer.replay(synthAudioSource, args.contains("--realtime"));
+
+        if (result.failed())
+        {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+
+        std::cout << replayer.createReport() << std::endl;
+
+        auto csvPath = getOptionValue(args, "--csv");
+
+        if (csvPath.isNotEmpty() && !replayer.writeCsv(juce::File::getCurrentWorkingDirectory().getChildFile(csvPath)))
+        {
+            std::cerr << "Couldn't write " << csvPath << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+}
+
+bool runCommandLineTool(const juce::String& commandLine)
+{
+    auto args = juce::StringArray::fromTokens(commandLine, true);
+    args.trim();
+    args.removeEmptyStrings();
+
+    if (args.contains("--replay"))
+    {
+        juce::JUCEApplicationBase::setApplicationReturnValue(replaySession(args));
+        return true;
+    }
+
+    if (args.contains("--bench-idle"))
+    {
+        juce::JUCEApplicationBase::setApplicationReturnValue(benchmarkIdle(args));
+        return true;
+    }
+
+    if (args.contains("--bench-layouts"))
+    {
+        juce::JUCEApplicationBase::setApplicationReturnValue(benchmarkLayouts(args));
+        return true;
+    }
+
+    if (args.contains("--check-mpe"))
+    {
+        juce::JUCEApplicationBase::setApplicationReturnValue(checkMPEPitch());
+        return true;
+    }
+
+    if (args.contains("--check-performance"))
+    {
+        juce::JUCEApplicationBase::setApplicationReturnValue(checkPerformance(args));
+        return true;
+    }
+
+    if (args.contains("--bench-plugin"))
+    {
+        juce::JUCEApplicationBase::setApplicationReturnValue(benchmarkPlugin(args));
+        return true;
+    }
+
+    return false;
+}
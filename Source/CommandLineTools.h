@@ -0,0 +1,24 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Headless tools that run instead of the GUI when Launchpad2 is started with
+    one of these options:
+
+        --replay <session.lpsc> [--realtime] [--csv <costs.csv>]
+        --bench-plugin [--block-size <samples>] [--blocks <count>]
+        --bench-idle [--block-size <samples>] [--blocks <count>]
+        --bench-layouts [--block-size <samples>] [--blocks <count>]
+        --check-mpe
+        --check-performance [performance options] [--seconds <count>]
+
+    Returns true if the command line asked for a tool; the tool's report is
+    written to stdout and the application exit code is set from its result.
+
+    Sessions for --replay are recorded by running the normal app with
+    --capture <session.lpsc>. --check-performance takes the same options as
+    --performance, see PerformanceSettings.
+*/
+bool runCommandLineTool(const juce::String& commandLine);
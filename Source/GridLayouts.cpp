@@ -0,0 +1,24 @@
+#include "GridLayouts.h"
+
+namespace
+{
+    const LatticeLayout<XYNoteMap, HarmonicLattice>         harmonicXY("Harmonic (Launchpad XY)");
+    const LatticeLayout<ProgrammerNoteMap, HarmonicLattice> harmonicProgrammer("Harmonic (Launchpad Pro/Mini)");
+    const LatticeLayout<XYNoteMap, RatioLattice>            ratioXY("Isomorphic ratios (Launchpad XY)");
+    const LatticeLayout<ProgrammerNoteMap, RatioLattice>    ratioProgrammer("Isomorphic ratios (Launchpad Pro/Mini)");
+    const LatticeLayout<XYNoteMap, FiveLimitLattice>        fiveLimitXY("3-limit x 5-limit (Launchpad XY)");
+    const LatticeLayout<ProgrammerNoteMap, FiveLimitLattice> fiveLimitProgrammer("3-limit x 5-limit (Launchpad Pro/Mini)");
+}
+
+const juce::Array<const GridLayout*>& GridLayouts::getAll()
+{
+    static const juce::Array<const GridLayout*> layouts { &harmonicXY, &harmonicProgrammer,
+                                                          &ratioXY, &ratioProgrammer,
+                                                          &fiveLimitXY, &fiveLimitProgrammer };
+    return layouts;
+}
+
+const GridLayout& GridLayouts::getDefault()
+{
+    return harmonicXY;
+}
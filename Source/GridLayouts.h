@@ -0,0 +1,207 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cmath>
+
+//==============================================================================
+// A pad on the grid: x counts columns from the left, y counts rows from the bottom.
+struct LatticePoint
+{
+    int x = 0;
+    int y = 0;
+    bool onGrid = false;
+};
+
+// The values a layout builds its frequencies from
+struct TuningValues
+{
+    double rootFreq;
+    double bassFreq;
+    double melFreq;
+};
+
+using NoteFrequencies = std::array<double, 128>;
+
+//==============================================================================
+/*
+    Maps MIDI note numbers to pitches. Layouts only run when the tuning or the
+    layout itself changes, filling a table that voices then index by note number.
+*/
+class GridLayout
+{
+public:
+    virtual ~GridLayout() = default;
+
+    virtual const char* getName() const = 0;
+
+    virtual LatticePoint getPointForNote(int midiNoteNumber) const = 0;
+
+    // the pad that is held down to pick new JI intervals from the grid
+    virtual int getModifierNote() const = 0;
+
+    // one frequency per MIDI note, 0 for notes that aren't on the grid
+    virtual void computeFrequencies(const TuningValues& tuning, NoteFrequencies& frequencies) const = 0;
+};
+
+//==============================================================================
+// Note maps: where a controller puts each MIDI note
+
+// Launchpad, Launchpad S and Mini MK1/MK2 in XY mode: note = row * 16 + column, row 0 at the top
+struct XYNoteMap
+{
+    // the bottom left pad
+    static constexpr int modifierNote = 112;
+
+    static constexpr LatticePoint pointForNote(int note)
+    {
+        return { note % 16, 7 - note / 16, true };
+    }
+};
+
+// Launchpad Pro, Mini MK3 and X in programmer mode: note = 10 * (row + 1) + column + 1, row 0 at the bottom.
+// Only the 8x8 pads are on the grid; the side column and the top row are buttons.
+struct ProgrammerNoteMap
+{
+    // the bottom left pad, as in XY mode: the side column and top row buttons send
+    // controller changes in programmer mode, which never reach the keyboard state
+    static constexpr int modifierNote = 11;
+
+    static constexpr LatticePoint pointForNote(int note)
+    {
+        return { note % 10 - 1, note / 10 - 1, note % 10 >= 1 && note % 10 <= 8 && note / 10 >= 1 && note / 10 <= 8 };
+    }
+};
+
+//==============================================================================
+// Lattices: what pitch each grid position plays
+
+// The original Launchpad2 mapping: columns add the melody frequency, rows add the bass frequency
+struct HarmonicLattice
+{
+    struct Coefficients { double x, y; };
+
+    static constexpr Coefficients coefficientsFor(LatticePoint point)
+    {
+        return { (double)point.x, (double)point.y };
+    }
+
+    static double frequency(Coefficients c, const TuningValues& tuning)
+    {
+        return c.x * tuning.melFreq + c.y * tuning.bassFreq;
+    }
+};
+
+// Isomorphic: each column multiplies by the melody ratio, each row by the bass ratio
+struct RatioLattice
+{
+    struct Coefficients { int x, y; };
+
+    static constexpr Coefficients coefficientsFor(LatticePoint point)
+    {
+        return { point.x, point.y };
+    }
+
+    static double frequency(Coefficients c, const TuningValues& tuning)
+    {
+        return tuning.rootFreq * std::pow(tuning.melFreq / tuning.bassFreq, c.x)
+                               * std::pow(tuning.bassFreq / tuning.rootFreq, c.y);
+    }
+};
+
+// 3-limit x 5-limit: columns step by fifths folded into one octave, rows step by major thirds
+struct FiveLimitLattice
+{
+    struct Coefficients { double ratio; };
+
+    static constexpr Coefficients coefficientsFor(LatticePoint point)
+    {
+        double fifths = 1.0;
+
+        for (int i = 0; i < point.x; ++i)
+        {
+            fifths *= 1.5;
+
+            if (fifths >= 2.0)
+                fifths *= 0.5;
+        }
+
+        double thirds = 1.0;
+
+        for (int i = 0; i < point.y; ++i)
+            thirds *= 1.25;
+
+        return { fifths * thirds };
+    }
+
+    static double frequency(Coefficients c, const TuningValues& tuning)
+    {
+        return c.ratio * tuning.rootFreq;
+    }
+};
+
+//==============================================================================
+namespace GridLayoutTables
+{
+    template <typename NoteMap>
+    constexpr std::array<LatticePoint, 128> makePoints()
+    {
+        std::array<LatticePoint, 128> table {};
+
+        for (int note = 0; note < 128; ++note)
+            table[(size_t)note] = NoteMap::pointForNote(note);
+
+        return table;
+    }
+
+    template <typename NoteMap, typename Lattice>
+    constexpr std::array<typename Lattice::Coefficients, 128> makeCoefficients()
+    {
+        auto points = makePoints<NoteMap>();
+        std::array<typename Lattice::Coefficients, 128> table {};
+
+        for (size_t note = 0; note < 128; ++note)
+            table[note] = Lattice::coefficientsFor(points[note]);
+
+        return table;
+    }
+}
+
+// A note map and a lattice combined, with all the per-note work done at compile time
+template <typename NoteMap, typename Lattice>
+class LatticeLayout : public GridLayout
+{
+public:
+    LatticeLayout(const char* layoutName) : name(layoutName) {}
+
+    const char* getName() const override { return name; }
+
+    LatticePoint getPointForNote(int midiNoteNumber) const override
+    {
+        return points[(size_t)midiNoteNumber];
+    }
+
+    int getModifierNote() const override { return NoteMap::modifierNote; }
+
+    void computeFrequencies(const TuningValues& tuning, NoteFrequencies& frequencies) const override
+    {
+        for (size_t note = 0; note < frequencies.size(); ++note)
+            frequencies[note] = points[note].onGrid ? Lattice::frequency(coefficients[note], tuning) : 0.0;
+    }
+
+private:
+    static constexpr std::array<LatticePoint, 128> points = GridLayoutTables::makePoints<NoteMap>();
+    static constexpr std::array<typename Lattice::Coefficients, 128> coefficients
+        = GridLayoutTables::makeCoefficients<NoteMap, Lattice>();
+
+    const char* name;
+};
+
+//==============================================================================
+namespace GridLayouts
+{
+    // every available layout; the first one is the default
+    const juce::Array<const GridLayout*>& getAll();
+
+    const GridLayout& getDefault();
+}
@@ -0,0 +1,235 @@
+#include "MPEOutput.h"
+
+MPEOutput::NotePitch MPEOutput::pitchForFrequency(double frequency)
+{
+    auto exactNote = 69.0 + 12.0 * std::log2(frequency / 440.0);
+    auto note = juce::jlimit(0, 127, juce::roundToInt(exactNote));
+    auto pitchBend = 8192 + juce::roundToInt((exactNote - note) * 8192.0 / pitchBendRange);
+
+    return { note, juce::jlimit(0, 16383, pitchBend) };
+}
+
+//==============================================================================
+MPEOutput::MPEOutput()
+    : juce::Thread("MPE output")
+{
+    resetChannels();
+}
+
+MPEOutput::~MPEOutput()
+{
+    close();
+}
+
+bool MPEOutput::open(const juce::String& deviceIdentifier)
+{
+    close();
+
+    auto newOutput = juce::MidiOutput::openDevice(deviceIdentifier);
+
+    if (newOutput == nullptr)
+        return false;
+
+    newOutput->startBackgroundThread();
+    newOutput->sendBlockOfMessagesNow(juce::MPEMessages::setLowerZone(numMemberChannels, pitchBendRange));
+
+    {
+        const juce::ScopedLock sl(outputLock);
+        output = std::move(newOutput);
+    }
+
+    // anything left from the previous device is stale, and the thread isn't reading now
+    fifo.finishedRead(fifo.getNumReady());
+    droppedNotes = 0;
+
+    // the thread only runs while there is a device
+    startThread();
+    enabled = true;
+    return true;
+}
+
+void MPEOutput::close()
+{
+    enabled = false;
+    stopThread(1000);
+
+    const juce::ScopedLock sl(outputLock);
+
+    if (output == nullptr)
+        return;
+
+    for (int channel = 1; channel <= 16; ++channel)
+        output->sendMessageNow(juce::MidiMessage::allNotesOff(channel));
+
+    output.reset();
+}
+
+bool MPEOutput::isOpen() const
+{
+    return enabled.load();
+}
+
+int MPEOutput::getNumDroppedNotes() const
+{
+    return droppedNotes.load();
+}
+
+void MPEOutput::resetChannels()
+{
+    std::fill(std::begin(channelForNote), std::end(channelForNote), 0);
+
+    // member channels of the lower zone are 2 to 16
+    for (int i = 0; i < numMemberChannels; ++i)
+        freeChannels[i] = i + 2;
+
+    firstFreeChannel = 0;
+    numFreeChannels = numMemberChannels;
+}
+
+void MPEOutput::processBlock(const juce::MidiBuffer& incomingMidi, const NoteFrequencies& frequencies,
+                             int numSamples, double sampleRate)
+{
+    auto isEnabled = enabled.load();
+
+    if (isEnabled != wasEnabled)
+    {
+        wasEnabled = isEnabled;
+        resetChannels();
+    }
+
+    if (!isEnabled || incomingMidi.isEmpty())
+        return;
+
+    lastSampleRate = sampleRate;
+
+    // stamped one block ahead, which keeps the spacing within the block and lands
+    // about when the internal synth's audio for the same block is heard
+    auto blockStartMs = juce::Time::getMillisecondCounterHiRes() + numSamples * 1000.0 / sampleRate;
+
+    for (const auto metadata : incomingMidi)
+    {
+        auto message = metadata.getMessage();
+        auto timeMs = blockStartMs + metadata.samplePosition * 1000.0 / sampleRate;
+
+        if (!message.isNoteOnOrOff())
+            continue;
+
+        auto note = message.getNoteNumber();
+
+        if (auto channel = channelForNote[note])
+        {
+            push(timeMs, (juce::uint8)(0x80 | (channel - 1)), (juce::uint8)outputNoteForNote[note], 0);
+
+            channelForNote[note] = 0;
+            freeChannels[(firstFreeChannel + numFreeChannels) % numMemberChannels] = channel;
+            ++numFreeChannels;
+        }
+
+        if (!message.isNoteOn())
+            continue;
+
+        auto frequency = frequencies[(size_t)note];
+
+        if (frequency <= 0.0)
+            continue;
+
+        if (numFreeChannels == 0)
+        {
+            ++droppedNotes;
+            continue;
+        }
+
+        auto channel = freeChannels[firstFreeChannel];
+        firstFreeChannel = (firstFreeChannel + 1) % numMemberChannels;
+        --numFreeChannels;
+
+        auto pitch = pitchForFrequency(frequency);
+        channelForNote[note] = channel;
+        outputNoteForNote[note] = pitch.note;
+
+        // the bend goes first so the note starts at the right pitch
+        push(timeMs, (juce::uint8)(0xe0 | (channel - 1)), (juce::uint8)(pitch.pitchBend & 0x7f), (juce::uint8)(pitch.pitchBend >> 7));
+        push(timeMs, (juce::uint8)(0x90 | (channel - 1)), (juce::uint8)pitch.note, message.getVelocity());
+    }
+}
+
+void MPEOutput::push(double timeMs, juce::uint8 status, juce::uint8 data1, juce::uint8 data2)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        ++droppedNotes;
+        return;
+    }
+
+    events[(size_t)start1] = { timeMs, { status, data1, data2 } };
+    fifo.finishedWrite(1);
+}
+
+void MPEOutput::enableWithoutDevice()
+{
+    close();
+
+    fifo.finishedRead(fifo.getNumReady());
+    droppedNotes = 0;
+    enabled = true;
+}
+
+void MPEOutput::popQueuedMessages(juce::MidiBuffer& destination)
+{
+    // the sender thread would be reading the same FIFO
+    jassert(!isThreadRunning());
+
+    readQueuedMessages(destination);
+}
+
+double MPEOutput::readQueuedMessages(juce::MidiBuffer& destination)
+{
+    auto numReady = fifo.getNumReady();
+
+    if (numReady == 0)
+        return -1.0;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+    auto sampleRate = lastSampleRate.load();
+    auto batchStartMs = events[(size_t)start1].timeMs;
+
+    auto addEvents = [&](int start, int size) {
+        for (int i = start; i < start + size; ++i)
+        {
+            auto& event = events[(size_t)i];
+            auto position = juce::jmax(0, juce::roundToInt((event.timeMs - batchStartMs) * sampleRate / 1000.0));
+            destination.addEvent(event.bytes, 3, position);
+        }
+    };
+
+    addEvents(start1, size1);
+    addEvents(start2, size2);
+    fifo.finishedRead(size1 + size2);
+
+    return batchStartMs;
+}
+
+void MPEOutput::run()
+{
+    // polls rather than being woken, since signalling it would take a lock on the audio thread
+    while (!threadShouldExit())
+    {
+        wait(1);
+
+        batch.clear();
+        auto batchStartMs = readQueuedMessages(batch);
+
+        if (batchStartMs < 0.0)
+            continue;
+
+        const juce::ScopedLock sl(outputLock);
+
+        if (output != nullptr)
+            output->sendBlockOfMessages(batch, batchStartMs, lastSampleRate.load());
+    }
+}
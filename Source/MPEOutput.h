@@ -0,0 +1,84 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "GridLayouts.h"
+
+//==============================================================================
+/*
+    Plays the grid on an external MPE synth: every note gets its own member
+    channel of the lower zone, and a per-note pitch bend that moves the nearest
+    MIDI note onto the JI frequency the internal synth would play.
+
+    The audio thread only queues timestamped messages in a lock-free FIFO; a
+    background thread polls it and hands them to the MIDI device in batches.
+    That thread only exists while a device is open.
+*/
+class MPEOutput : private juce::Thread
+{
+public:
+    // semitones, the MPE default for member channels
+    static constexpr int pitchBendRange = 48;
+    static constexpr int numMemberChannels = 15;
+
+    struct NotePitch
+    {
+        int note;
+        int pitchBend;  // 14-bit, 8192 is the centre
+    };
+
+    static NotePitch pitchForFrequency(double frequency);
+
+    MPEOutput();
+    ~MPEOutput() override;
+
+    // message thread
+    bool open(const juce::String& deviceIdentifier);
+    void close();
+    bool isOpen() const;
+
+    // audio thread: queues MPE messages for the note-ons and note-offs in the block
+    void processBlock(const juce::MidiBuffer& incomingMidi, const NoteFrequencies& frequencies,
+                      int numSamples, double sampleRate);
+
+    // for tests: queues messages as if a device were open, for popQueuedMessages() to take
+    // out exactly as the sender thread would have passed them to the device
+    void enableWithoutDevice();
+    void popQueuedMessages(juce::MidiBuffer& destination);
+
+    // messages lost because the FIFO or the member channels were full, since the device was opened
+    int getNumDroppedNotes() const;
+
+private:
+    struct Event
+    {
+        double timeMs;
+        juce::uint8 bytes[3];
+    };
+
+    void run() override;
+    double readQueuedMessages(juce::MidiBuffer& destination);  // the first event's time, or -1 if none
+    void push(double timeMs, juce::uint8 status, juce::uint8 data1, juce::uint8 data2);
+    void resetChannels();
+
+    // audio thread only. Free channels are a ring, so the channel that has been
+    // silent longest is reused first and release tails keep their pitch bend.
+    int channelForNote[128];
+    int outputNoteForNote[128];
+    int freeChannels[numMemberChannels];
+    int firstFreeChannel = 0;
+    int numFreeChannels = 0;
+    bool wasEnabled = false;
+
+    juce::AbstractFifo fifo { 1024 };
+    std::array<Event, 1024> events;
+
+    std::atomic<bool> enabled { false };
+    std::atomic<double> lastSampleRate { 44100.0 };
+    std::atomic<int> droppedNotes { 0 };
+
+    juce::CriticalSection outputLock;
+    std::unique_ptr<juce::MidiOutput> output;
+    juce::MidiBuffer batch;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MPEOutput)
+};
@@ -8,6 +8,8 @@
 
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "CommandLineTools.h"
+#include "PerformanceMode.h"
 
 //==============================================================================
 class Launchpad2Application  : public juce::JUCEApplication
@@ -25,7 +27,26 @@ public:
     {
         // This method is where you should put your application's initialisation code..
 
+        if (runCommandLineTool (commandLine))
+        {
+            quit();
+            return;
+        }
+
         mainWindow.reset (new MainWindow (getApplicationName()));
+
+        auto args = juce::StringArray::fromTokens (commandLine, true);
+        auto captureIndex = args.indexOf ("--capture");
+
+        if (auto* mainComponent = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+        {
+            if (args.contains ("--performance"))
+                mainComponent->startPerformanceMode (PerformanceSettings::fromCommandLine (args));
+
+            if (captureIndex >= 0)
+                mainComponent->startSessionCapture (juce::File::getCurrentWorkingDirectory()
+                                                        .getChildFile (args[captureIndex + 1].unquoted()));
+        }
     }
 
     void shutdown() override
@@ -1,135 +1,7 @@
 #include "MainComponent.h"
-
-
-double melFreq = 0.0;
-double bassFreq = 0.0;
-
-SineWaveVoice::SineWaveVoice() {};
-
-bool SineWaveVoice::canPlaySound(juce::SynthesiserSound* sound)
-{
-    return dynamic_cast<SineWaveSound*> (sound) != nullptr;
-}
-
-
-void SineWaveVoice::startNote(int midiNoteNumber, float velocity,
-    juce::SynthesiserSound*, int /*currentPitchWheelPosition*/)
-{
-    currentAngle = 0.0;
-    level = velocity;
-    tailOff = 0.0;
-
-    // this is where the magic equation happens
-    auto cyclesPerSecond = ((midiNoteNumber % 16) * melFreq) + ((7 - (midiNoteNumber / 16)) * bassFreq);
-    auto cyclesPerSample = cyclesPerSecond / getSampleRate();
-
-    angleDelta = cyclesPerSample * 2.0 * juce::MathConstants<double>::pi;
-}
-
-void SineWaveVoice::stopNote(float /*velocity*/, bool allowTailOff) 
-{
-    if (allowTailOff)
-    {
-        if (tailOff == 0.0)
-            tailOff = 1.0;
-    }
-    else
-    {
-        clearCurrentNote();
-        angleDelta = 0.0;
-    }
-}
-
-void SineWaveVoice::pitchWheelMoved(int) {}
-void SineWaveVoice::controllerMoved(int, int) {}
-
-void SineWaveVoice::renderNextBlock(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
-{
-    if (angleDelta != 0.0)
-    {
-        if (tailOff > 0.0)
-        {
-            while (--numSamples >= 0)
-            {
-                auto currentSample = (float)(std::sin(currentAngle) * level * tailOff);
-
-                for (auto i = outputBuffer.getNumChannels(); --i >= 0;)
-                    outputBuffer.addSample(i, startSample, currentSample);
-
-                currentAngle += angleDelta;
-                ++startSample;
-
-                tailOff *= 0.99;
-
-                if (tailOff <= 0.005)
-                {
-                    clearCurrentNote();
-
-                    angleDelta = 0.0;
-                    break;
-                }
-            }
-        }
-        else
-        {
-            while (--numSamples >= 0) 
-            {
-                auto currentSample = (float)(std::sin(currentAngle) * level);
-
-                for (auto i = outputBuffer.getNumChannels(); --i >= 0;)
-                    outputBuffer.addSample(i, startSample, currentSample);
-
-                currentAngle += angleDelta;
-                ++startSample;
-            }
-        }
-    }
-}
-
-//==============================================================================
-
-SynthAudioSource::SynthAudioSource(juce::MidiKeyboardState& keyState)
-    : keyboardState(keyState)
-{
-    for (auto i = 0; i < 4; ++i)
-        synth.addVoice(new SineWaveVoice());
-
-    synth.addSound(new SineWaveSound());
-}
-
-void SynthAudioSource::setUsingSineWaveSound()
-{
-    synth.clearSounds();
-}
-
-void SynthAudioSource::prepareToPlay(int /*samplesPerBlockExpected*/, double sampleRate)
-{
-    synth.setCurrentPlaybackSampleRate(sampleRate);
-    midiCollector.reset(sampleRate); 
-}
-
-void SynthAudioSource::releaseResources() {};
-
-void SynthAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
-{
-    bufferToFill.clearActiveBufferRegion();
-
-    juce::MidiBuffer incomingMidi;
-    midiCollector.removeNextBlockOfMessages(incomingMidi, bufferToFill.numSamples);
-
-
-    keyboardState.processNextMidiBuffer(incomingMidi, bufferToFill.startSample,
-        bufferToFill.numSamples, true);
-
-    synth.renderNextBlock(*bufferToFill.buffer, incomingMidi,
-        bufferToFill.startSample, bufferToFill.numSamples);
-}
-
-juce::MidiMessageCollector* SynthAudioSource::getMidiCollector()
-{
-    return &midiCollector;
-}
-
+#include "SessionCapture.h"
+#include "PerformanceMode.h"
+#include "MPEOutput.h"
 
 //==============================================================================
 MainComponent::MainComponent() : 
@@ -176,6 +48,36 @@ MainComponent::MainComponent() :
     midiInputList.addItemList(midiInputNames, 1);
     midiInputList.onChange = [this] { setMidiInput(midiInputList.getSelectedItemIndex()); };
 
+    addAndMakeVisible(layoutListLabel);
+    layoutListLabel.setText("Grid Layout:", juce::dontSendNotification);
+    layoutListLabel.attachToComponent(&layoutList, true);
+
+    addAndMakeVisible(layoutList);
+    for (auto* layout : GridLayouts::getAll())
+        layoutList.addItem(layout->getName(), layoutList.getNumItems() + 1);
+
+    layoutList.setSelectedItemIndex(0, juce::dontSendNotification);
+    layoutList.onChange = [this] { synthAudioSource.setGridLayout(*GridLayouts::getAll()[layoutList.getSelectedItemIndex()]); };
+
+    mpeOutput = std::make_unique<MPEOutput>();
+    synthAudioSource.setMPEOutput(mpeOutput.get());
+
+    addAndMakeVisible(midiOutputListLabel);
+    midiOutputListLabel.setText("MPE Output:", juce::dontSendNotification);
+    midiOutputListLabel.attachToComponent(&midiOutputList, true);
+
+    addAndMakeVisible(midiOutputList);
+    midiOutputList.addItem("None", 1);
+    for (auto output : juce::MidiOutput::getAvailableDevices())
+        midiOutputList.addItem(output.name, midiOutputList.getNumItems() + 1);
+
+    midiOutputList.setSelectedId(1, juce::dontSendNotification);
+    midiOutputList.onChange = [this] { setMidiOutput(midiOutputList.getSelectedItemIndex() - 1); };
+
+    addAndMakeVisible(internalSynthToggle);
+    internalSynthToggle.setToggleState(true, juce::dontSendNotification);
+    internalSynthToggle.onClick = [this] { synthAudioSource.setInternalRenderingEnabled(internalSynthToggle.getToggleState()); };
+
     for (auto input : midiInputs)
     {
         if (deviceManager.isMidiInputDeviceEnabled(input.identifier))
@@ -229,6 +131,69 @@ MainComponent::~MainComponent()
 {
     // This shuts down the audio device and clears the audio source.
     shutdownAudio();
+    synthAudioSource.setSessionRecorder(nullptr);
+
+    if (mpeOutput->getNumDroppedNotes() > 0)
+        juce::Logger::writeToLog("MPE output dropped " + juce::String(mpeOutput->getNumDroppedNotes()) + " notes");
+
+    // the replay report shows where these are missing, but only this tells it's the capture's fault
+    if (sessionRecorder != nullptr && sessionRecorder->getNumDroppedRecords() > 0)
+        juce::Logger::writeToLog("Session capture dropped " + juce::String(sessionRecorder->getNumDroppedRecords())
+                                 + " records, the log has gaps");
+}
+
+bool MainComponent::startSessionCapture(const juce::File& logFile)
+{
+    // only one capture per run: the audio thread may still hold the previous recorder
+    if (sessionRecorder != nullptr)
+        return false;
+
+    sessionRecorder = std::make_unique<SessionRecorder>(logFile);
+
+    if (!sessionRecorder->isOpen())
+    {
+        sessionRecorder.reset();
+        return false;
+    }
+
+    synthAudioSource.setSessionRecorder(sessionRecorder.get());
+    logMessage("Capturing session to " + logFile.getFullPathName());
+    return true;
+}
+
+bool MainComponent::startPerformanceMode(const PerformanceSettings& settings)
+{
+    if (performanceMonitor != nullptr)
+        return false;
+
+    performanceMonitor = std::make_unique<PerformanceMonitor>(deviceManager, settings);
+    performanceMonitor->onReport = [this](const juce::String& report) {
+        logMessage(report);
+        juce::Logger::writeToLog(report);
+    };
+
+    // published before the device restarts, so its prepareToPlay already sees the monitor
+    activePerformanceMonitor = performanceMonitor.get();
+
+    auto error = performanceMonitor->start();
+
+    if (error.isNotEmpty())
+    {
+        activePerformanceMonitor = nullptr;
+
+        // wait out any callback that loaded the monitor before deleting it
+        {
+            const juce::ScopedLock sl(deviceManager.getAudioCallbackLock());
+        }
+
+        performanceMonitor.reset();
+
+        logMessage("Performance mode: " + error);
+        juce::Logger::writeToLog("Performance mode: " + error);
+        return false;
+    }
+
+    return true;
 }
 
 //==============================================================================
@@ -243,6 +208,9 @@ void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRat
     // For more details, see the help for AudioProcessor::prepareToPlay()
     midiCollector.reset(sampleRate);
     synthAudioSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    if (auto* monitor = activePerformanceMonitor.load())
+        monitor->prepareToPlay(sampleRate);
 }
 
 void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
@@ -283,7 +251,15 @@ void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& buffe
     */
 
 
+    auto* monitor = activePerformanceMonitor.load();
+
+    if (monitor != nullptr)
+        monitor->processInput(bufferToFill);
+
     synthAudioSource.getNextAudioBlock(bufferToFill);
+
+    if (monitor != nullptr)
+        monitor->processOutput(bufferToFill);
 }
 
 void MainComponent::releaseResources()
@@ -312,6 +288,11 @@ void MainComponent::resized()
     auto area = getLocalBounds();
 
     midiInputList.setBounds(area.removeFromTop(36).removeFromRight(getWidth() - 150).removeFromLeft(getWidth() - 300).reduced(8));
+    layoutList.setBounds(area.removeFromTop(36).removeFromRight(getWidth() - 150).removeFromLeft(getWidth() - 300).reduced(8));
+
+    auto outputRow = area.removeFromTop(36).removeFromRight(getWidth() - 150);
+    midiOutputList.setBounds(outputRow.removeFromLeft(getWidth() - 300).reduced(8));
+    internalSynthToggle.setBounds(outputRow.reduced(8));
     midiMessagesBox.setBounds(area.removeFromTop(64).reduced(8));
 
     auto grid = area.removeFromRight(area.getHeight()).reduced(15);
@@ -360,38 +341,72 @@ void MainComponent::setMidiInput(int index)
     lastInputIndex = index;
 }
 
+void MainComponent::setMidiOutput(int index)
+{
+    if (mpeOutput->isOpen() && mpeOutput->getNumDroppedNotes() > 0)
+        logMessage("MPE output dropped " + juce::String(mpeOutput->getNumDroppedNotes()) + " notes");
+
+    // index -1 is "None"
+    if (index < 0)
+    {
+        mpeOutput->close();
+        return;
+    }
+
+    auto output = juce::MidiOutput::getAvailableDevices()[index];
+
+    if (mpeOutput->open(output.identifier))
+        logMessage("Sending MPE to " + output.name);
+    else
+        logMessage("Couldn't open " + output.name);
+}
+
 void MainComponent::handleNoteOn(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) {
-    if (midiNoteNumber == 112) changingJIInterval = true;
-    else if (changingJIInterval) {
-        bassNum = JIIntervals[7 - (midiNoteNumber / 16)][0];
-        bassDen = JIIntervals[7 - (midiNoteNumber / 16)][1];
-        melNum = JIIntervals[midiNoteNumber % 8][0];
-        melDen = JIIntervals[midiNoteNumber % 8][1];
+    auto& layout = synthAudioSource.getGridLayout();
+    auto point = layout.getPointForNote(midiNoteNumber);
+
+    if (midiNoteNumber == layout.getModifierNote()) changingJIInterval = true;
+    else if (changingJIInterval && point.onGrid && point.y < 8) {
+        bassNum = JIIntervals[point.y][0];
+        bassDen = JIIntervals[point.y][1];
+        melNum = JIIntervals[point.x % 8][0];
+        melDen = JIIntervals[point.x % 8][1];
         setJIFrequencies();
     }
 
     juce::MessageManager::callAsync([=]() {
-        int i = 7 - (midiNoteNumber / 16);
-        int j = midiNoteNumber % 16;
-        buttonGrid[i][j].setColours(juce::Colours::green, juce::Colours::yellowgreen, juce::Colours::red);
-        buttonGrid[i][j].repaint();
-        logMessage(juce::String("Note On [") + juce::String(i) + juce::String(", ") + juce::String(j) + juce::String("]"));
+        if (auto* button = getGridButton(point)) {
+            button->setColours(juce::Colours::green, juce::Colours::yellowgreen, juce::Colours::red);
+            button->repaint();
+        }
+        logMessage(juce::String("Note On [") + juce::String(point.y) + juce::String(", ") + juce::String(point.x) + juce::String("]"));
         logMessage(juce::String(midiNoteNumber));
     });
 };
 
 void MainComponent::handleNoteOff(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) {
-    if (midiNoteNumber == 112) changingJIInterval = false;
+    auto& layout = synthAudioSource.getGridLayout();
+    auto point = layout.getPointForNote(midiNoteNumber);
+
+    if (midiNoteNumber == layout.getModifierNote()) changingJIInterval = false;
 
     juce::MessageManager::callAsync([=]() {
-        int i = 7 - (midiNoteNumber / 16); 
-        int j = midiNoteNumber % 16;
-        buttonGrid[i][j].setColours(juce::Colours::lightgrey, juce::Colours::yellow, juce::Colours::orangered);
-        buttonGrid[i][j].repaint();
-        logMessage(juce::String("Note Off [") + juce::String(i) + juce::String(", ") + juce::String(j) + juce::String("]"));;
+        if (auto* button = getGridButton(point)) {
+            button->setColours(juce::Colours::lightgrey, juce::Colours::yellow, juce::Colours::orangered);
+            button->repaint();
+        }
+        logMessage(juce::String("Note Off [") + juce::String(point.y) + juce::String(", ") + juce::String(point.x) + juce::String("]"));
     });
 };
 
+GridButton* MainComponent::getGridButton(LatticePoint point) {
+    // buttonGrid rows are laid out from the bottom, like the layouts' y axis
+    if (!point.onGrid || point.x < 0 || point.x >= 8 || point.y < 0 || point.y >= 8)
+        return nullptr;
+
+    return &buttonGrid[point.y][point.x];
+}
+
 bool MainComponent::keyPressed(const juce::KeyPress& key, Component* originatingComponent)
 {
     bool jiNumberChanged = false;
@@ -519,8 +534,8 @@ void MainComponent::buttonClicked(juce::Button* button) {
 }
 
 void MainComponent::setJIFrequencies() {
-    bassFreq = rootFreq * bassNum / bassDen;
-    melFreq = bassFreq * melNum / melDen;
+    auto newBassFreq = rootFreq * bassNum / bassDen;
+    synthAudioSource.setJIFrequencies(rootFreq, newBassFreq, newBassFreq * melNum / melDen);
     juce::MessageManager::callAsync([=]() {
         melNumButton.setButtonText(juce::String(melNum));
 
@@ -1,61 +1,12 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "SynthEngine.h"
 
-//==============================================================================
-
-
-struct SineWaveSound : public juce::SynthesiserSound
-{
-    SineWaveSound() {}
-
-    bool appliesToNote(int) override { return true; }
-    bool appliesToChannel(int) override { return true; }
-};
-
-//==============================================================================
-struct SineWaveVoice : public juce::SynthesiserVoice
-{
-    SineWaveVoice();
-
-    bool canPlaySound(juce::SynthesiserSound* sound) override;
-
-    void startNote(int midiNoteNumber, float velocity,
-        juce::SynthesiserSound*, int /*currentPitchWheelPosition*/) override;
-
-    void stopNote(float /*velocity*/, bool allowTailOff) override;
-
-    void pitchWheelMoved(int) override;
-    void controllerMoved(int, int) override;
-
-    void renderNextBlock(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples) override;
-   
-
-private:
-    double currentAngle = 0.0, angleDelta = 0.0, level = 0.0, tailOff = 0.0;
-};
-
-//==============================================================================
-class SynthAudioSource : public juce::AudioSource
-{
-public:
-    SynthAudioSource(juce::MidiKeyboardState& keyState);
-
-    void setUsingSineWaveSound();
-
-    void prepareToPlay(int /*samplesPerBlockExpected*/, double sampleRate) override;
-
-    void releaseResources() override;
-
-    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
-
-    juce::MidiMessageCollector* getMidiCollector();
-
-private:
-    juce::MidiKeyboardState& keyboardState;
-    juce::Synthesiser synth;
-    juce::MidiMessageCollector midiCollector;
-};
+class SessionRecorder;
+class MPEOutput;
+class PerformanceMonitor;
+struct PerformanceSettings;
 
 class GridButton : public juce::ShapeButton
 {
@@ -80,6 +31,9 @@ public:
     void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override;
     void releaseResources() override;
 
+    bool startSessionCapture(const juce::File& logFile);
+    bool startPerformanceMode(const PerformanceSettings& settings);
+
     //==============================================================================
     void paint (juce::Graphics& g) override;
     void resized() override;
@@ -111,6 +65,16 @@ private:
     juce::Label midiInputListLabel;
     int lastInputIndex = 0;
 
+    juce::ComboBox layoutList;
+    juce::Label layoutListLabel;
+
+    std::unique_ptr<MPEOutput> mpeOutput;
+    juce::ComboBox midiOutputList;
+    juce::Label midiOutputListLabel;
+    juce::ToggleButton internalSynthToggle { "Internal synth" };
+    void setMidiOutput(int index);
+    GridButton* getGridButton(LatticePoint point);
+
     juce::TextEditor midiMessagesBox;
     void logMessage(const juce::String& m);
 
@@ -131,5 +95,10 @@ private:
 
     int* jiNumberTarget;
 
+    std::unique_ptr<SessionRecorder> sessionRecorder;
+
+    std::unique_ptr<PerformanceMonitor> performanceMonitor;
+    std::atomic<PerformanceMonitor*> activePerformanceMonitor { nullptr };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 };
@@ -0,0 +1,280 @@
+#include "PerformanceMode.h"
+
+#if JUCE_LINUX
+ #include <cerrno>
+ #include <cstring>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <sys/mman.h>
+#endif
+
+PerformanceSettings PerformanceSettings::fromCommandLine(const juce::StringArray& args)
+{
+    PerformanceSettings settings;
+
+    auto getValue = [&args](const juce::String& option) {
+        auto index = args.indexOf(option);
+        return index >= 0 ? args[index + 1].unquoted() : juce::String();
+    };
+
+    if (args.contains("--alsa"))
+        settings.deviceType = "ALSA";
+    else if (args.contains("--jack"))
+        settings.deviceType = "JACK";
+
+    settings.deviceName = getValue("--device");
+
+    if (args.contains("--buffer"))   settings.bufferSize = juce::jmax(16, getValue("--buffer").getIntValue());
+    if (args.contains("--rate"))     settings.sampleRate = juce::jmax(8000.0, getValue("--rate").getDoubleValue());
+    if (args.contains("--priority")) settings.realtimePriority = juce::jlimit(1, 99, getValue("--priority").getIntValue());
+
+    settings.cpuCore = args.contains("--core") ? getValue("--core").getIntValue()
+                                               : PerformanceMode::findIsolatedCore();
+
+    settings.measureLatency = args.contains("--measure-latency");
+
+    return settings;
+}
+
+//==============================================================================
+int PerformanceMode::findIsolatedCore()
+{
+    // a cpu list like "2-3,6", or empty when nothing is isolated
+    auto isolated = juce::File("/sys/devices/system/cpu/isolated").loadFileAsString().trim();
+
+    if (isolated.isEmpty())
+        return -1;
+
+    return isolated.initialSectionContainingOnly("0123456789").getIntValue();
+}
+
+juce::String PerformanceMode::lockMemory()
+{
+   #if JUCE_LINUX
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        return "mlockall failed: " + juce::String(std::strerror(errno)) + " (check ulimit -l)";
+
+    return {};
+   #else
+    return "memory locking is only supported on Linux";
+   #endif
+}
+
+void PerformanceMode::prefaultStack()
+{
+    volatile char stack[64 * 1024];
+
+    for (size_t i = 0; i < sizeof(stack); i += 4096)
+        stack[i] = 0;
+}
+
+//==============================================================================
+void LatencyMeter::prepare(double sampleRate)
+{
+    clickInterval = juce::roundToInt(sampleRate);
+    silenceBeforeClick = clickInterval / 4;
+    samplesUntilClick = clickInterval;
+    samplesSinceClick = -1;
+}
+
+void LatencyMeter::processInput(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (samplesSinceClick < 0 || bufferToFill.buffer->getNumChannels() == 0)
+        return;
+
+    auto* input = bufferToFill.buffer->getReadPointer(0, bufferToFill.startSample);
+
+    for (int i = 0; i < bufferToFill.numSamples; ++i)
+    {
+        if (std::abs(input[i]) > 0.25f)
+        {
+            lastRoundTrip = samplesSinceClick + i;
+            samplesSinceClick = -1;
+            return;
+        }
+    }
+
+    samplesSinceClick += bufferToFill.numSamples;
+
+    // lost it, e.g. nothing is connected to the input: try again with the next click
+    if (samplesSinceClick > clickInterval)
+        samplesSinceClick = -1;
+}
+
+void LatencyMeter::processOutput(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (bufferToFill.buffer->getNumChannels() == 0)
+        return;
+
+    // the loopback brings the synth back too, and it's louder than the threshold: nothing
+    // but the click may be heard from a while before it goes out until it comes back
+    if (samplesSinceClick >= 0 || samplesUntilClick < bufferToFill.numSamples + silenceBeforeClick)
+        bufferToFill.clearActiveBufferRegion();
+
+    if (samplesSinceClick >= 0)
+        return;
+
+    if (samplesUntilClick >= bufferToFill.numSamples)
+    {
+        samplesUntilClick -= bufferToFill.numSamples;
+        return;
+    }
+
+    bufferToFill.buffer->setSample(0, bufferToFill.startSample + samplesUntilClick, 0.5f);
+
+    samplesSinceClick = bufferToFill.numSamples - samplesUntilClick;
+    samplesUntilClick = clickInterval;
+}
+
+int LatencyMeter::getLastRoundTrip() const
+{
+    return lastRoundTrip.load();
+}
+
+//==============================================================================
+PerformanceMonitor::PerformanceMonitor(juce::AudioDeviceManager& manager, const PerformanceSettings& settingsToUse)
+    : deviceManager(manager), settings(settingsToUse)
+{
+}
+
+PerformanceMonitor::~PerformanceMonitor()
+{
+    stopTimer();
+}
+
+juce::String PerformanceMonitor::start()
+{
+    deviceManager.setCurrentAudioDeviceType(settings.deviceType, true);
+
+    if (deviceManager.getCurrentAudioDeviceType() != settings.deviceType)
+        return settings.deviceType + " isn't available";
+
+    auto setup = deviceManager.getAudioDeviceSetup();
+    setup.bufferSize = settings.bufferSize;
+    setup.sampleRate = settings.sampleRate;
+
+    setup.useDefaultOutputChannels = false;
+    setup.outputChannels.clear();
+    setup.outputChannels.setRange(0, 2, true);
+
+    if (settings.deviceName.isNotEmpty())
+        setup.outputDeviceName = settings.deviceName;
+
+    if (settings.measureLatency)
+    {
+        if (settings.deviceName.isNotEmpty())
+            setup.inputDeviceName = settings.deviceName;
+
+        setup.useDefaultInputChannels = false;
+        setup.inputChannels.clear();
+        setup.inputChannels.setRange(0, 1, true);
+    }
+
+    threadNeedsPromotion = true;
+
+    auto error = deviceManager.setAudioDeviceSetup(setup, true);
+
+    if (error.isNotEmpty())
+        return error;
+
+    if (deviceManager.getCurrentAudioDevice() == nullptr)
+        return "No " + settings.deviceType + " device could be opened";
+
+    // only worth pinning the process in RAM once it's really going to run
+    memoryLockError = PerformanceMode::lockMemory();
+
+    startTimer(2000);
+    return {};
+}
+
+void PerformanceMonitor::prepareToPlay(double sampleRate)
+{
+    latencyMeter.prepare(sampleRate);
+
+    // a restarted device may call back on a new thread
+    threadNeedsPromotion = true;
+}
+
+void PerformanceMonitor::processInput(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (threadNeedsPromotion.exchange(false))
+    {
+       #if JUCE_LINUX
+        sched_param param {};
+        param.sched_priority = settings.realtimePriority;
+        realtimeScheduling = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+
+        if (settings.cpuCore >= 0)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(settings.cpuCore, &cpus);
+            pinnedToCore = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+        }
+       #endif
+
+        PerformanceMode::prefaultStack();
+    }
+
+    if (settings.measureLatency)
+        latencyMeter.processInput(bufferToFill);
+}
+
+void PerformanceMonitor::processOutput(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (settings.measureLatency)
+        latencyMeter.processOutput(bufferToFill);
+}
+
+bool PerformanceMonitor::isAudioThreadRealtime() const
+{
+    return realtimeScheduling.load();
+}
+
+void PerformanceMonitor::timerCallback()
+{
+    if (onReport != nullptr)
+        onReport(createReport());
+}
+
+juce::String PerformanceMonitor::createReport()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+
+    if (device == nullptr)
+        return "Performance mode: no audio device";
+
+    auto sampleRate = device->getCurrentSampleRate();
+    auto bufferSize = device->getCurrentBufferSizeSamples();
+    auto inputLatency = device->getInputLatencyInSamples();
+    auto outputLatency = device->getOutputLatencyInSamples();
+    auto toMs = [sampleRate](int samples) { return juce::String(samples * 1000.0 / sampleRate, 2) + " ms"; };
+
+    juce::String report;
+    report << device->getTypeName() << " \"" << device->getName() << "\", "
+           << bufferSize << " samples @ " << sampleRate << " Hz" << juce::newLine
+           << "  reported latency: in " << inputLatency << " + out " << outputLatency
+           << " + buffer " << bufferSize << " = " << toMs(inputLatency + outputLatency + bufferSize) << juce::newLine;
+
+    if (settings.measureLatency)
+    {
+        auto roundTrip = latencyMeter.getLastRoundTrip();
+        report << "  measured round trip: "
+               << (roundTrip >= 0 ? juce::String(roundTrip) + " samples (" + toMs(roundTrip) + ")"
+                                  : juce::String("no click received, is the output looped back?"))
+               << juce::newLine;
+    }
+
+    auto xruns = device->getXRunCount();
+    report << "  xruns: " << (xruns < 0 ? juce::String("not reported by this device")
+                                       : juce::String(xruns) + " (+" + juce::String(xruns - lastXRunCount) + ")")
+           << juce::newLine;
+    lastXRunCount = juce::jmax(0, xruns);
+
+    report << "  audio thread: SCHED_FIFO " << settings.realtimePriority << (realtimeScheduling ? " ok" : " failed")
+           << ", core " << (settings.cpuCore < 0 ? juce::String("not pinned")
+                                                  : juce::String(settings.cpuCore) + (pinnedToCore ? " ok" : " failed"))
+           << ", memory " << (memoryLockError.isEmpty() ? juce::String("locked") : memoryLockError);
+
+    return report;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Settings for running on stage with small buffers. Parsed from:
+
+        --performance [--jack | --alsa] [--device <name>] [--buffer <samples>]
+                      [--rate <hz>] [--core <n>] [--priority <1-99>] [--measure-latency]
+
+    Without --core the audio thread goes to the first core listed in
+    /sys/devices/system/cpu/isolated, if there is one.
+
+    It can be checked without a GUI or audio hardware against the JACK dummy
+    backend:
+
+        jackd -d dummy -r 48000 -p 32 &
+        Launchpad2 --check-performance --jack --buffer 32 --seconds 10
+
+    which plays a chord for ten seconds and then prints the report:
+
+        JACK "<device>", 32 samples @ 48000 Hz
+          reported latency: in <n> + out <n> + buffer 32 = <total> ms
+          xruns: 0 (+0)
+          audio thread: SCHED_FIFO 80 ok, core not pinned, memory locked
+
+    and exits with 1 if the device didn't open, the thread wasn't promoted or
+    there were xruns.
+
+    SCHED_FIFO and memory locking need rtprio and memlock limits for the user,
+    e.g. from the audio group in /etc/security/limits.d.
+*/
+struct PerformanceSettings
+{
+    juce::String deviceType = "JACK";
+    juce::String deviceName;
+    int bufferSize = 64;
+    double sampleRate = 48000.0;
+    int cpuCore = -1;
+    int realtimePriority = 80;
+    bool measureLatency = false;
+
+    static PerformanceSettings fromCommandLine(const juce::StringArray& args);
+};
+
+namespace PerformanceMode
+{
+    // the first core the kernel was booted with isolcpus= for, or -1
+    int findIsolatedCore();
+
+    // mlockall, so nothing the process touches can be paged out; returns an error or an empty string
+    juce::String lockMemory();
+
+    // touches the next chunk of the calling thread's stack so the audio callback never faults on it
+    void prefaultStack();
+}
+
+//==============================================================================
+/*
+    Measures round trip latency by sending a single sample click out of the
+    first output channel and waiting for it on the first input channel. Needs a
+    loopback: a cable, or for JACK our own output port connected to our input.
+
+    Anything loud coming back would count as the click, so the output is muted
+    from a quarter of a second before each click until it returns. While
+    measuring, the synth drops out for that long once a second, and round trips
+    longer than the muted lead-in can be mistaken for the synth.
+*/
+class LatencyMeter
+{
+public:
+    void prepare(double sampleRate);
+
+    // audio thread: call before the input is overwritten, then after the output is rendered
+    void processInput(const juce::AudioSourceChannelInfo& bufferToFill);
+    void processOutput(const juce::AudioSourceChannelInfo& bufferToFill);
+
+    // the last measured round trip in samples, or -1 if no click came back yet
+    int getLastRoundTrip() const;
+
+private:
+    int clickInterval = 48000;
+    int silenceBeforeClick = 12000;
+    int samplesUntilClick = 0;
+    int samplesSinceClick = -1;
+    std::atomic<int> lastRoundTrip { -1 };
+};
+
+//==============================================================================
+/*
+    Applies the performance settings to the device manager, promotes the audio
+    thread from inside the callback and periodically reports latency and xruns.
+*/
+class PerformanceMonitor : private juce::Timer
+{
+public:
+    PerformanceMonitor(juce::AudioDeviceManager& manager, const PerformanceSettings& settingsToUse);
+    ~PerformanceMonitor() override;
+
+    // returns an error, or an empty string once the device is running with these settings
+    juce::String start();
+
+    // the device, its latency and xruns, and what the audio thread got
+    juce::String createReport();
+
+    // true once the audio thread runs with SCHED_FIFO
+    bool isAudioThreadRealtime() const;
+
+    // message thread: called on every report
+    std::function<void(const juce::String&)> onReport;
+
+    // audio thread
+    void prepareToPlay(double sampleRate);
+    void processInput(const juce::AudioSourceChannelInfo& bufferToFill);
+    void processOutput(const juce::AudioSourceChannelInfo& bufferToFill);
+
+private:
+    void timerCallback() override;
+
+    juce::AudioDeviceManager& deviceManager;
+    PerformanceSettings settings;
+    juce::String memoryLockError;
+
+    LatencyMeter latencyMeter;
+
+    std::atomic<bool> threadNeedsPromotion { true };
+    std::atomic<bool> realtimeScheduling { false };
+    std::atomic<bool> pinnedToCore { false };
+
+    int lastXRunCount = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerformanceMonitor)
+};
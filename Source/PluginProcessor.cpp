@@ -0,0 +1,136 @@
+#include "PluginProcessor.h"
+
+//==============================================================================
+JISynthAudioProcessor::JISynthAudioProcessor()
+    : AudioProcessor(BusesProperties().withOutput("Output", juce::AudioChannelSet::stereo(), true)),
+      parameters(*this, nullptr, "JISynth", createParameterLayout()),
+      synthAudioSource(keyboardState)
+{
+    bassNum = parameters.getRawParameterValue("bassNum");
+    bassDen = parameters.getRawParameterValue("bassDen");
+    melNum = parameters.getRawParameterValue("melNum");
+    melDen = parameters.getRawParameterValue("melDen");
+    rootFreq = parameters.getRawParameterValue("rootFreq");
+    layout = parameters.getRawParameterValue("layout");
+
+    updateJIFrequencies();
+}
+
+JISynthAudioProcessor::~JISynthAudioProcessor() {}
+
+juce::AudioProcessorValueTreeState::ParameterLayout JISynthAudioProcessor::createParameterLayout()
+{
+    juce::StringArray layoutNames;
+    for (auto* gridLayout : GridLayouts::getAll())
+        layoutNames.add(gridLayout->getName());
+
+    // same ranges as the number keys of the standalone app
+    return {
+        std::make_unique<juce::AudioParameterInt>("bassNum", "Bass Numerator", 1, 20, 1),
+        std::make_unique<juce::AudioParameterInt>("bassDen", "Bass Denominator", 1, 20, 1),
+        std::make_unique<juce::AudioParameterInt>("melNum", "Melody Numerator", 1, 20, 3),
+        std::make_unique<juce::AudioParameterInt>("melDen", "Melody Denominator", 1, 20, 2),
+        std::make_unique<juce::AudioParameterFloat>("rootFreq", "Root Frequency",
+            juce::NormalisableRange<float>(20.0f, 2000.0f, 0.0f, 0.3f),
+            (float)juce::MidiMessage::getMidiNoteInHertz(48)),
+        std::make_unique<juce::AudioParameterChoice>("layout", "Grid Layout", layoutNames, 0)
+    };
+}
+
+//==============================================================================
+void JISynthAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
+{
+    setLatencySamples(0);
+    synthAudioSource.prepareToPlay(samplesPerBlock, sampleRate);
+    updateJIFrequencies();
+}
+
+void JISynthAudioProcessor::releaseResources()
+{
+    synthAudioSource.releaseResources();
+}
+
+bool JISynthAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+    auto output = layouts.getMainOutputChannelSet();
+    return output == juce::AudioChannelSet::mono() || output == juce::AudioChannelSet::stereo();
+}
+
+void JISynthAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    updateJIFrequencies();
+
+    juce::AudioSourceChannelInfo bufferToFill(&buffer, 0, buffer.getNumSamples());
+    synthAudioSource.renderBlock(bufferToFill, midiMessages);
+
+    // the synth consumes the notes, it doesn't pass them on
+    midiMessages.clear();
+}
+
+void JISynthAudioProcessor::updateJIFrequencies()
+{
+    auto newBassFreq = rootFreq->load() * (double)juce::roundToInt(bassNum->load())
+                                        / (double)juce::roundToInt(bassDen->load());
+    auto newMelFreq = newBassFreq * (double)juce::roundToInt(melNum->load())
+                                  / (double)juce::roundToInt(melDen->load());
+
+    synthAudioSource.setJIFrequencies(rootFreq->load(), newBassFreq, newMelFreq);
+
+    if (auto* newLayout = GridLayouts::getAll()[juce::roundToInt(layout->load())])
+        synthAudioSource.setGridLayout(*newLayout);
+}
+
+//==============================================================================
+juce::AudioProcessorEditor* JISynthAudioProcessor::createEditor()
+{
+    return new juce::GenericAudioProcessorEditor(*this);
+}
+
+bool JISynthAudioProcessor::hasEditor() const { return true; }
+
+//==============================================================================
+const juce::String JISynthAudioProcessor::getName() const { return "JI Synth"; }
+
+bool JISynthAudioProcessor::acceptsMidi() const { return true; }
+bool JISynthAudioProcessor::producesMidi() const { return false; }
+bool JISynthAudioProcessor::isMidiEffect() const { return false; }
+
+double JISynthAudioProcessor::getTailLengthSeconds() const
+{
+    auto sampleRate = getSampleRate();
+    return sampleRate > 0.0 ? SynthAudioSource::getTailLengthSamples() / sampleRate : 0.0;
+}
+
+//==============================================================================
+int JISynthAudioProcessor::getNumPrograms() { return 1; }
+int JISynthAudioProcessor::getCurrentProgram() { return 0; }
+void JISynthAudioProcessor::setCurrentProgram(int) {}
+const juce::String JISynthAudioProcessor::getProgramName(int) { return {}; }
+void JISynthAudioProcessor::changeProgramName(int, const juce::String&) {}
+
+//==============================================================================
+void JISynthAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
+{
+    if (auto xml = parameters.copyState().createXml())
+        copyXmlToBinary(*xml, destData);
+}
+
+void JISynthAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    if (auto xml = getXmlFromBinary(data, sizeInBytes))
+        if (xml->hasTagName(parameters.state.getType()))
+            parameters.replaceState(juce::ValueTree::fromXml(*xml));
+}
+
+juce::AudioProcessorValueTreeState& JISynthAudioProcessor::getParameters()
+{
+    return parameters;
+}
+
+//==============================================================================
+#if defined (JucePlugin_Name)
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new JISynthAudioProcessor();
+}
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SynthEngine.h"
+
+//==============================================================================
+/*
+    The JI synth engine as a plug-in, built by the JISynth target in
+    CMakeLists.txt. createPluginFilter() is only compiled into plug-in builds.
+
+    Automation is applied per block, not sample accurately: the tuning
+    parameters are read from their atomics once, before any MIDI in the block is
+    handled. A voice latches its frequency when its note starts, so every
+    note-on sees the tuning the host delivered for its block, including notes
+    the host placed before an automation point inside that block. Hosts that
+    need finer resolution have to use smaller blocks.
+*/
+class JISynthAudioProcessor : public juce::AudioProcessor
+{
+public:
+    JISynthAudioProcessor();
+    ~JISynthAudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+    bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
+
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
+    using AudioProcessor::processBlock;
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram(int index) override;
+    const juce::String getProgramName(int index) override;
+    void changeProgramName(int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+    juce::AudioProcessorValueTreeState& getParameters();
+
+private:
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    void updateJIFrequencies();
+
+    juce::AudioProcessorValueTreeState parameters;
+
+    std::atomic<float>* bassNum;
+    std::atomic<float>* bassDen;
+    std::atomic<float>* melNum;
+    std::atomic<float>* melDen;
+    std::atomic<float>* rootFreq;
+    std::atomic<float>* layout;
+
+    juce::MidiKeyboardState keyboardState;
+    SynthAudioSource synthAudioSource;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JISynthAudioProcessor)
+};
@@ -0,0 +1,393 @@
+#include "SessionCapture.h"
+#include "SynthEngine.h"
+
+namespace
+{
+    template <typename T>
+    void writeValue(juce::uint8* dest, int& pos, T value)
+    {
+        std::memcpy(dest + pos, &value, sizeof(T));
+        pos += (int)sizeof(T);
+    }
+
+    template <typename T>
+    bool readValue(const juce::uint8* data, size_t size, size_t& pos, T& value)
+    {
+        if (pos + sizeof(T) > size)
+            return false;
+
+        std::memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+}
+
+//==============================================================================
+SessionRecorder::SessionRecorder(const juce::File& logFile, int fifoSizeBytes)
+    : juce::Thread("Session recorder"),
+      fifo(fifoSizeBytes),
+      fifoData((size_t)fifoSizeBytes),
+      scratch((size_t)(64 * 1024)),
+      scratchSize(64 * 1024)
+{
+    // touch the FIFO now so the audio thread's first writes don't page fault
+    fifoData.clear((size_t)fifoSizeBytes);
+    scratch.clear((size_t)scratchSize);
+
+    logFile.deleteFile();
+    stream = std::make_unique<juce::FileOutputStream>(logFile);
+
+    if (!stream->openedOk())
+    {
+        stream.reset();
+        return;
+    }
+
+    stream->write(SessionLog::magic, sizeof(SessionLog::magic));
+    stream->write(&SessionLog::version, sizeof(SessionLog::version));
+
+    startThread();
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    stopThread(2000);
+}
+
+bool SessionRecorder::isOpen() const
+{
+    return stream != nullptr;
+}
+
+int SessionRecorder::getNumDroppedRecords() const
+{
+    return droppedRecords.load();
+}
+
+void SessionRecorder::recordPrepare(double sampleRate, int samplesPerBlockExpected)
+{
+    auto pos = SessionLog::recordHeaderSize;
+    writeValue(scratch.get(), pos, sampleRate);
+    writeValue(scratch.get(), pos, (juce::int32)samplesPerBlockExpected);
+    writeValue(scratch.get(), pos, juce::Time::getHighResolutionTicksPerSecond());
+
+    pushRecord(SessionLog::prepareRecord, pos - SessionLog::recordHeaderSize);
+}
+
+void SessionRecorder::recordTuning(const TuningValues& tuning, int layoutIndex)
+{
+    auto pos = SessionLog::recordHeaderSize;
+    writeValue(scratch.get(), pos, tuning.rootFreq);
+    writeValue(scratch.get(), pos, tuning.bassFreq);
+    writeValue(scratch.get(), pos, tuning.melFreq);
+    writeValue(scratch.get(), pos, (juce::int32)layoutIndex);
+
+    pushRecord(SessionLog::tuningRecord, pos - SessionLog::recordHeaderSize);
+}
+
+void SessionRecorder::recordBlock(const juce::MidiBuffer& midi, int startSample, int numSamples)
+{
+    auto pos = SessionLog::recordHeaderSize;
+    writeValue(scratch.get(), pos, juce::Time::getHighResolutionTicks());
+    writeValue(scratch.get(), pos, (juce::int32)startSample);
+    writeValue(scratch.get(), pos, (juce::int32)numSamples);
+    writeValue(scratch.get(), pos, (juce::int32)midi.getNumEvents());
+
+    for (const auto metadata : midi)
+    {
+        auto eventSize = 4 + 2 + metadata.numBytes;
+
+        if (metadata.numBytes > 0xffff || pos + eventSize > scratchSize)
+        {
+            ++droppedRecords;
+            return;
+        }
+
+        writeValue(scratch.get(), pos, (juce::int32)metadata.samplePosition);
+        writeValue(scratch.get(), pos, (juce::uint16)metadata.numBytes);
+        std::memcpy(scratch.get() + pos, metadata.data, (size_t)metadata.numBytes);
+        pos += metadata.numBytes;
+    }
+
+    pushRecord(SessionLog::blockRecord, pos - SessionLog::recordHeaderSize);
+}
+
+void SessionRecorder::pushRecord(SessionLog::RecordType type, int payloadSize)
+{
+    if (stream == nullptr)
+        return;
+
+    auto pos = 0;
+    writeValue(scratch.get(), pos, (juce::uint8)type);
+    writeValue(scratch.get(), pos, (juce::uint32)payloadSize);
+
+    auto recordSize = SessionLog::recordHeaderSize + payloadSize;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(recordSize, start1, size1, start2, size2);
+
+    // a record is only published whole, so the writer never sees half of one
+    if (size1 + size2 < recordSize)
+    {
+        ++droppedRecords;
+        return;
+    }
+
+    std::memcpy(fifoData.get() + start1, scratch.get(), (size_t)size1);
+
+    if (size2 > 0)
+        std::memcpy(fifoData.get() + start2, scratch.get() + size1, (size_t)size2);
+
+    fifo.finishedWrite(size1 + size2);
+}
+
+void SessionRecorder::run()
+{
+    while (!threadShouldExit())
+    {
+        drainFifo();
+        wait(10);
+    }
+
+    drainFifo();
+    stream->flush();
+}
+
+void SessionRecorder::drainFifo()
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    if (size1 > 0)
+        stream->write(fifoData.get() + start1, (size_t)size1);
+
+    if (size2 > 0)
+        stream->write(fifoData.get() + start2, (size_t)size2);
+
+    fifo.finishedRead(size1 + size2);
+}
+
+//==============================================================================
+SessionReplayer::SessionReplayer(const juce::File& logFile)
+{
+    logFile.loadFileAsData(log);
+}
+
+juce::Result SessionReplayer::replay(SynthAudioSource& source, bool realTimePacing)
+{
+    blockCosts.clear();
+
+    auto* data = static_cast<const juce::uint8*>(log.getData());
+    auto size = log.getSize();
+    size_t pos = 0;
+
+    char magic[4] = {};
+    juce::uint32 version = 0;
+
+    if (!readValue(data, size, pos, magic) || std::memcmp(magic, SessionLog::magic, sizeof(magic)) != 0)
+        return juce::Result::fail("Not a session log");
+
+    if (!readValue(data, size, pos, version) || version != SessionLog::version)
+        return juce::Result::fail("Unsupported session log version " + juce::String(version));
+
+    double sampleRate = 0.0;
+    juce::int64 ticksPerSecond = 1;
+    juce::int64 firstTicks = -1;
+    double replayStartMs = 0.0;
+
+    juce::AudioBuffer<float> buffer(2, 0);
+    juce::MidiBuffer midi;
+
+    while (pos < size)
+    {
+        juce::uint8 type = 0;
+        juce::uint32 payloadSize = 0;
+
+        if (!readValue(data, size, pos, type) || !readValue(data, size, pos, payloadSize)
+            || pos + payloadSize > size)
+            return juce::Result::fail("Truncated record at byte " + juce::String((juce::int64)pos));
+
+        auto recordEnd = pos + payloadSize;
+
+        if (type == SessionLog::prepareRecord)
+        {
+            juce::int32 samplesPerBlockExpected = 0;
+
+            if (!readValue(data, recordEnd, pos, sampleRate) || !readValue(data, recordEnd, pos, samplesPerBlockExpected)
+                || !readValue(data, recordEnd, pos, ticksPerSecond))
+                return juce::Result::fail("Truncated prepare record at byte " + juce::String((juce::int64)pos));
+
+            buffer.setSize(2, juce::jmax(buffer.getNumSamples(), (int)samplesPerBlockExpected));
+            source.prepareToPlay(samplesPerBlockExpected, sampleRate);
+        }
+        else if (type == SessionLog::tuningRecord)
+        {
+            TuningValues tuning {};
+            juce::int32 layoutIndex = 0;
+
+            if (!readValue(data, recordEnd, pos, tuning.rootFreq) || !readValue(data, recordEnd, pos, tuning.bassFreq)
+                || !readValue(data, recordEnd, pos, tuning.melFreq) || !readValue(data, recordEnd, pos, layoutIndex))
+                return juce::Result::fail("Truncated tuning record at byte " + juce::String((juce::int64)pos));
+
+            auto* layout = GridLayouts::getAll()[layoutIndex];
+
+            if (layout == nullptr)
+                return juce::Result::fail("Unknown grid layout " + juce::String(layoutIndex) + " in tuning record");
+
+            source.setGridLayout(*layout);
+
+            source.setJIFrequencies(tuning.rootFreq, tuning.bassFreq, tuning.melFreq);
+        }
+        else if (type == SessionLog::blockRecord)
+        {
+            if (sampleRate <= 0.0)
+                return juce::Result::fail("Block record before prepare record");
+
+            juce::int64 ticks = 0;
+            juce::int32 startSample = 0, numSamples = 0, numEvents = 0;
+
+            if (!readValue(data, recordEnd, pos, ticks) || !readValue(data, recordEnd, pos, startSample)
+                || !readValue(data, recordEnd, pos, numSamples) || !readValue(data, recordEnd, pos, numEvents))
+                return juce::Result::fail("Truncated block record at byte " + juce::String((juce::int64)pos));
+
+            midi.clear();
+
+            for (int i = 0; i < numEvents; ++i)
+            {
+                juce::int32 samplePosition = 0;
+                juce::uint16 numBytes = 0;
+
+                if (!readValue(data, recordEnd, pos, samplePosition) || !readValue(data, recordEnd, pos, numBytes)
+                    || pos + numBytes > recordEnd)
+                    return juce::Result::fail("Truncated MIDI event in block " + juce::String((int)blockCosts.size()));
+
+                midi.addEvent(data + pos, numBytes, samplePosition);
+                pos += numBytes;
+            }
+
+            if (buffer.getNumSamples() < startSample + numSamples)
+                buffer.setSize(2, startSample + numSamples);
+
+            if (firstTicks < 0)
+            {
+                firstTicks = ticks;
+                replayStartMs = juce::Time::getMillisecondCounterHiRes();
+            }
+
+            auto sessionTime = (double)(ticks - firstTicks) / (double)ticksPerSecond;
+
+            if (realTimePacing)
+            {
+                auto targetMs = replayStartMs + sessionTime * 1000.0;
+
+                while (juce::Time::getMillisecondCounterHiRes() < targetMs)
+                    juce::Thread::sleep(juce::jmax(0, (int)(targetMs - juce::Time::getMillisecondCounterHiRes()) - 1));
+            }
+
+            juce::AudioSourceChannelInfo info(&buffer, startSample, numSamples);
+
+            auto startTicks = juce::Time::getHighResolutionTicks();
+            source.renderBlock(info, midi);
+            auto endTicks = juce::Time::getHighResolutionTicks();
+
+            blockCosts.push_back({ (int)blockCosts.size(), sessionTime, numSamples, numEvents,
+                                   juce::Time::highResolutionTicksToSeconds(endTicks - startTicks) * 1.0e6,
+                                   numSamples * 1.0e6 / sampleRate });
+        }
+
+        // skip anything a newer writer appended that we don't understand
+        pos = recordEnd;
+    }
+
+    return juce::Result::ok();
+}
+
+const std::vector<SessionReplayer::BlockCost>& SessionReplayer::getBlockCosts() const
+{
+    return blockCosts;
+}
+
+juce::String SessionReplayer::createReport(int numWorstBlocks) const
+{
+    if (blockCosts.empty())
+        return "No blocks replayed";
+
+    std::vector<double> sorted;
+    double totalRender = 0.0, totalBudget = 0.0;
+
+    for (auto& cost : blockCosts)
+    {
+        sorted.push_back(cost.renderMicros);
+        totalRender += cost.renderMicros;
+        totalBudget += cost.budgetMicros;
+    }
+
+    std::sort(sorted.begin(), sorted.end());
+
+    auto percentile = [&sorted](double p) { return sorted[(size_t)(p * (double)(sorted.size() - 1))]; };
+
+    juce::String report;
+    report << "Replayed " << (int)blockCosts.size() << " blocks, "
+           << juce::String(totalBudget / 1.0e6, 2) << " s of audio in "
+           << juce::String(totalRender / 1.0e3, 2) << " ms ("
+           << juce::String(100.0 * totalRender / totalBudget, 2) << "% of real time)" << juce::newLine
+           << "Render cost per block (us): mean " << juce::String(totalRender / (double)sorted.size(), 2)
+           << ", p50 " << juce::String(percentile(0.5), 2)
+           << ", p99 " << juce::String(percentile(0.99), 2)
+           << ", max " << juce::String(sorted.back(), 2) << juce::newLine;
+
+    // a block that starts more than a block late means records are missing: dropped by the
+    // recorder, or the device skipped callbacks
+    int numGaps = 0;
+    double longestGap = 0.0, longestGapTime = 0.0;
+
+    for (size_t i = 1; i < blockCosts.size(); ++i)
+    {
+        auto& previous = blockCosts[i - 1];
+        auto gapMicros = (blockCosts[i].sessionTime - previous.sessionTime) * 1.0e6 - previous.budgetMicros;
+
+        if (gapMicros > previous.budgetMicros)
+        {
+            ++numGaps;
+
+            if (gapMicros > longestGap)
+            {
+                longestGap = gapMicros;
+                longestGapTime = previous.sessionTime;
+            }
+        }
+    }
+
+    if (numGaps > 0)
+        report << "Gaps in the block timestamps: " << numGaps << ", longest " << juce::String(longestGap / 1.0e3, 2)
+               << " ms after " << juce::String(longestGapTime, 3) << " s" << juce::newLine;
+
+    auto worst = blockCosts;
+    std::sort(worst.begin(), worst.end(),
+              [](const BlockCost& a, const BlockCost& b) { return a.renderMicros > b.renderMicros; });
+
+    report << "Most expensive blocks:" << juce::newLine;
+
+    for (int i = 0; i < juce::jmin(numWorstBlocks, (int)worst.size()); ++i)
+    {
+        auto& cost = worst[(size_t)i];
+        report << "  #" << cost.blockIndex << " at " << juce::String(cost.sessionTime, 3) << " s: "
+               << juce::String(cost.renderMicros, 2) << " us for " << cost.numSamples << " samples, "
+               << cost.numEvents << " MIDI events ("
+               << juce::String(100.0 * cost.renderMicros / cost.budgetMicros, 2) << "% of budget)" << juce::newLine;
+    }
+
+    return report;
+}
+
+bool SessionReplayer::writeCsv(const juce::File& csvFile) const
+{
+    juce::String csv("block,session_time_s,num_samples,num_events,render_us,budget_us\n");
+
+    for (auto& cost : blockCosts)
+        csv << cost.blockIndex << "," << juce::String(cost.sessionTime, 6) << "," << cost.numSamples << ","
+            << cost.numEvents << "," << juce::String(cost.renderMicros, 3) << ","
+            << juce::String(cost.budgetMicros, 3) << "\n";
+
+    return csvFile.replaceWithText(csv);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "GridLayouts.h"
+
+class SynthAudioSource;
+
+//==============================================================================
+/*
+    Session logs are a small append-only binary format:
+
+        "LPSC" magic, uint32 version
+        then records of: uint8 type, uint32 payloadSize, payload
+
+    All values are written in the byte order of the capturing machine.
+*/
+namespace SessionLog
+{
+    enum RecordType : juce::uint8
+    {
+        prepareRecord = 1,  // double sampleRate, int32 samplesPerBlockExpected, int64 ticksPerSecond
+        tuningRecord  = 2,  // double rootFreq, double bassFreq, double melFreq, int32 layoutIndex
+        blockRecord   = 3   // int64 ticks, int32 startSample, int32 numSamples, int32 numEvents,
+                            // then per event: int32 samplePosition, uint16 numBytes, bytes
+    };
+
+    static constexpr char magic[4] = { 'L', 'P', 'S', 'C' };
+    // 2: tuning records carry the grid layout index
+    static constexpr juce::uint32 version = 2;
+    static constexpr int recordHeaderSize = 1 + 4;
+}
+
+//==============================================================================
+/*
+    Records everything the synth sees on the audio thread. The audio thread only
+    copies records into a lock-free FIFO; a background thread drains that into
+    the log file. Records that don't fit in the FIFO are dropped and counted;
+    the replay report shows the gaps they leave in the block timestamps.
+*/
+class SessionRecorder : private juce::Thread
+{
+public:
+    SessionRecorder(const juce::File& logFile, int fifoSizeBytes = 1 << 20);
+    ~SessionRecorder() override;
+
+    bool isOpen() const;
+    int getNumDroppedRecords() const;
+
+    // audio thread only
+    void recordPrepare(double sampleRate, int samplesPerBlockExpected);
+    void recordTuning(const TuningValues& tuning, int layoutIndex);
+    void recordBlock(const juce::MidiBuffer& midi, int startSample, int numSamples);
+
+private:
+    void run() override;
+    void drainFifo();
+    void pushRecord(SessionLog::RecordType type, int payloadSize);
+
+    std::unique_ptr<juce::FileOutputStream> stream;
+
+    juce::AbstractFifo fifo;
+    juce::HeapBlock<juce::uint8> fifoData;
+    juce::HeapBlock<juce::uint8> scratch;
+    int scratchSize;
+
+    std::atomic<int> droppedRecords { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SessionRecorder)
+};
+
+//==============================================================================
+/*
+    Pushes a captured session back through a SynthAudioSource, block for block,
+    and measures how long each block took to render.
+*/
+class SessionReplayer
+{
+public:
+    struct BlockCost
+    {
+        int blockIndex;
+        double sessionTime;     // seconds since the first captured block
+        int numSamples;
+        int numEvents;
+        double renderMicros;
+        double budgetMicros;    // length of the block in real time
+    };
+
+    SessionReplayer(const juce::File& logFile);
+
+    juce::Result replay(SynthAudioSource& source, bool realTimePacing);
+
+    const std::vector<BlockCost>& getBlockCosts() const;
+    juce::String createReport(int numWorstBlocks = 10) const;
+    bool writeCsv(const juce::File& csvFile) const;
+
+private:
+    juce::MemoryBlock log;
+    std::vector<BlockCost> blockCosts;
+};
@@ -0,0 +1,357 @@
+#include "SynthEngine.h"
+#include "SessionCapture.h"
+#include "MPEOutput.h"
+
+namespace
+{
+    // how many samples the 0.99 per sample tail takes to fall to 0.005
+    constexpr int countTailOffSamples()
+    {
+        int numSamples = 0;
+
+        for (double level = 1.0; level > 0.005; level *= 0.99)
+            ++numSamples;
+
+        return numSamples;
+    }
+
+    constexpr int tailOffLength = countTailOffSamples();
+}
+
+SineWaveVoice::SineWaveVoice(const NoteFrequencies& frequencies, juce::uint32& activeVoiceMask, juce::uint32 bit)
+    : noteFrequencies(frequencies), activeVoices(activeVoiceMask), voiceBit(bit)
+{};
+
+bool SineWaveVoice::canPlaySound(juce::SynthesiserSound* sound)
+{
+    return dynamic_cast<SineWaveSound*> (sound) != nullptr;
+}
+
+
+void SineWaveVoice::startNote(int midiNoteNumber, float velocity,
+    juce::SynthesiserSound*, int /*currentPitchWheelPosition*/)
+{
+    currentAngle = 0.0;
+    level = velocity;
+    tailOff = 0.0;
+
+    // the magic equation now lives in the grid layout, which has already been applied to every note
+    auto cyclesPerSecond = noteFrequencies[(size_t)midiNoteNumber];
+
+    // notes the layout leaves silent must not hold on to the voice
+    if (cyclesPerSecond <= 0.0)
+    {
+        finishNote();
+        return;
+    }
+
+    frequency = cyclesPerSecond;
+    auto cyclesPerSample = cyclesPerSecond / getSampleRate();
+
+    angleDelta = cyclesPerSample * 2.0 * juce::MathConstants<double>::pi;
+
+    activeVoices |= voiceBit;
+}
+
+void SineWaveVoice::stopNote(float /*velocity*/, bool allowTailOff) 
+{
+    if (allowTailOff)
+    {
+        if (tailOff == 0.0)
+        {
+            tailOff = 1.0;
+            tailOffSamplesRemaining = tailOffLength;
+        }
+    }
+    else
+    {
+        finishNote();
+    }
+}
+
+void SineWaveVoice::finishNote()
+{
+    clearCurrentNote();
+    angleDelta = 0.0;
+    frequency = 0.0;
+    activeVoices &= ~voiceBit;
+}
+
+double SineWaveVoice::getFrequency() const
+{
+    return frequency;
+}
+
+void SineWaveVoice::pitchWheelMoved(int) {}
+void SineWaveVoice::controllerMoved(int, int) {}
+
+void SineWaveVoice::renderNextBlock(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
+{
+    if (angleDelta != 0.0)
+    {
+        if (tailOff > 0.0)
+        {
+            // the tail's length is known up front, so the loop doesn't have to test the level
+            auto numToRender = juce::jmin(numSamples, tailOffSamplesRemaining);
+            tailOffSamplesRemaining -= numToRender;
+
+            while (--numToRender >= 0)
+            {
+                auto currentSample = (float)(std::sin(currentAngle) * level * tailOff);
+
+                for (auto i = outputBuffer.getNumChannels(); --i >= 0;)
+                    outputBuffer.addSample(i, startSample, currentSample);
+
+                currentAngle += angleDelta;
+                ++startSample;
+
+                tailOff *= 0.99;
+            }
+
+            if (tailOffSamplesRemaining == 0)
+                finishNote();
+        }
+        else
+        {
+            while (--numSamples >= 0) 
+            {
+                auto currentSample = (float)(std::sin(currentAngle) * level);
+
+                for (auto i = outputBuffer.getNumChannels(); --i >= 0;)
+                    outputBuffer.addSample(i, startSample, currentSample);
+
+                currentAngle += angleDelta;
+                ++startSample;
+            }
+        }
+    }
+}
+
+//==============================================================================
+void JITuning::store(const TuningValues& newValues)
+{
+    auto start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    rootFreq.store(newValues.rootFreq, std::memory_order_relaxed);
+    bassFreq.store(newValues.bassFreq, std::memory_order_relaxed);
+    melFreq.store(newValues.melFreq, std::memory_order_relaxed);
+
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+bool JITuning::tryLoad(TuningValues& values) const
+{
+    // bounded, so the audio thread never spins on a writer that got preempted mid-store
+    for (int attempt = 0; attempt < 4; ++attempt)
+    {
+        auto before = sequence.load(std::memory_order_acquire);
+
+        if ((before & 1) != 0)
+            continue;
+
+        TuningValues loaded { rootFreq.load(std::memory_order_relaxed),
+                              bassFreq.load(std::memory_order_relaxed),
+                              melFreq.load(std::memory_order_relaxed) };
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (sequence.load(std::memory_order_relaxed) == before)
+        {
+            values = loaded;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//==============================================================================
+void JISynthesiser::renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+{
+    for (auto mask = activeVoiceMask; mask != 0; mask &= mask - 1)
+    {
+        auto index = 0;
+
+        while ((mask & (1u << index)) == 0)
+            ++index;
+
+        voices.getUnchecked(index)->renderNextBlock(outputAudio, startSample, numSamples);
+    }
+}
+
+//==============================================================================
+
+SynthAudioSource::SynthAudioSource(juce::MidiKeyboardState& keyState)
+    : keyboardState(keyState)
+{
+    for (auto i = 0; i < numVoices; ++i)
+        synth.addVoice(new SineWaveVoice(noteFrequencies, synth.activeVoiceMask, 1u << i));
+
+    synth.addSound(new SineWaveSound());
+}
+
+void SynthAudioSource::setUsingSineWaveSound()
+{
+    synth.clearSounds();
+}
+
+void SynthAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    synth.setCurrentPlaybackSampleRate(sampleRate);
+    midiCollector.reset(sampleRate); 
+
+    // the audio thread only clears this, so it never has to grow mid-session. Its pages are
+    // only guaranteed to be resident in performance mode, where mlockall(MCL_FUTURE) faults
+    // in every allocation as it is made.
+    incomingMidi.ensureSize(4096);
+
+    currentSampleRate = sampleRate;
+    currentBlockSize = samplesPerBlockExpected;
+
+    // makes the next block re-send the prepare and tuning records
+    activeRecorder = nullptr;
+}
+
+void SynthAudioSource::releaseResources() {};
+
+void SynthAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    incomingMidi.clear();
+    midiCollector.removeNextBlockOfMessages(incomingMidi, bufferToFill.numSamples);
+
+
+    keyboardState.processNextMidiBuffer(incomingMidi, bufferToFill.startSample,
+        bufferToFill.numSamples, true);
+
+    auto tuningChanged = updateNoteFrequencies();
+
+    // JI changes made by the keyboard listeners above are logged before the block,
+    // so a replay renders it with the same tuning
+    if (auto* recorder = sessionRecorder.load())
+    {
+        if (recorder != activeRecorder)
+        {
+            activeRecorder = recorder;
+            recorder->recordPrepare(currentSampleRate, currentBlockSize);
+            recorder->recordTuning(currentTuning, GridLayouts::getAll().indexOf(currentLayout));
+        }
+        else if (tuningChanged)
+        {
+            recorder->recordTuning(currentTuning, GridLayouts::getAll().indexOf(currentLayout));
+        }
+
+        recorder->recordBlock(incomingMidi, bufferToFill.startSample, bufferToFill.numSamples);
+    }
+
+    renderSynth(bufferToFill, incomingMidi);
+}
+
+void SynthAudioSource::renderBlock(const juce::AudioSourceChannelInfo& bufferToFill, juce::MidiBuffer& midi)
+{
+    keyboardState.processNextMidiBuffer(midi, bufferToFill.startSample,
+        bufferToFill.numSamples, true);
+
+    updateNoteFrequencies();
+    renderSynth(bufferToFill, midi);
+}
+
+bool SynthAudioSource::updateNoteFrequencies()
+{
+    auto newTuning = currentTuning;
+    tuning.tryLoad(newTuning);
+    auto* newLayout = tuning.layout.load();
+
+    if (newLayout == currentLayout && newTuning.rootFreq == currentTuning.rootFreq
+        && newTuning.bassFreq == currentTuning.bassFreq && newTuning.melFreq == currentTuning.melFreq)
+        return false;
+
+    currentTuning = newTuning;
+    currentLayout = newLayout;
+    currentLayout->computeFrequencies(currentTuning, noteFrequencies);
+    return true;
+}
+
+void SynthAudioSource::renderSynth(const juce::AudioSourceChannelInfo& bufferToFill, const juce::MidiBuffer& midi)
+{
+    if (auto* output = mpeOutput.load())
+        output->processBlock(midi, noteFrequencies, bufferToFill.numSamples, currentSampleRate);
+
+    bufferToFill.clearActiveBufferRegion();
+
+    // with internal rendering off the voices get no MIDI at all, so the ones still playing are
+    // released here rather than left waiting for note-offs; they go idle once their tails end
+    auto isRendering = internalRendering.load();
+
+    if (wasRendering && !isRendering)
+        synth.allNotesOff(0, true);
+
+    wasRendering = isRendering;
+
+    auto& synthMidi = isRendering ? midi : noMidi;
+
+    // nothing sounding and nothing to start a note: the block is just silence
+    if (synth.isIdle() && synthMidi.isEmpty())
+        return;
+
+    juce::ScopedNoDenormals noDenormals;
+
+    synth.renderNextBlock(*bufferToFill.buffer, synthMidi,
+        bufferToFill.startSample, bufferToFill.numSamples);
+}
+
+void SynthAudioSource::setJIFrequencies(double newRootFreq, double newBassFreq, double newMelFreq)
+{
+    tuning.store({ newRootFreq, newBassFreq, newMelFreq });
+}
+
+void SynthAudioSource::setGridLayout(const GridLayout& newLayout)
+{
+    tuning.layout = &newLayout;
+}
+
+const GridLayout& SynthAudioSource::getGridLayout() const
+{
+    return *tuning.layout.load();
+}
+
+bool SynthAudioSource::isIdle() const
+{
+    return synth.isIdle();
+}
+
+int SynthAudioSource::getTailLengthSamples()
+{
+    return tailOffLength;
+}
+
+double SynthAudioSource::getVoiceFrequency(int midiNoteNumber) const
+{
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (auto* voice = dynamic_cast<SineWaveVoice*>(synth.getVoice(i)))
+            if (voice->getCurrentlyPlayingNote() == midiNoteNumber)
+                return voice->getFrequency();
+
+    return 0.0;
+}
+
+void SynthAudioSource::setSessionRecorder(SessionRecorder* recorder)
+{
+    sessionRecorder = recorder;
+}
+
+void SynthAudioSource::setMPEOutput(MPEOutput* output)
+{
+    mpeOutput = output;
+}
+
+void SynthAudioSource::setInternalRenderingEnabled(bool shouldRender)
+{
+    internalRendering = shouldRender;
+}
+
+juce::MidiMessageCollector* SynthAudioSource::getMidiCollector()
+{
+    return &midiCollector;
+}
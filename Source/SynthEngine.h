@@ -0,0 +1,166 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "GridLayouts.h"
+
+class SessionRecorder;
+class MPEOutput;
+
+//==============================================================================
+/*
+    The JI synth engine, shared by the standalone app and the plug-in. Nothing
+    in here knows about the GUI; the session recorder and the MPE output are
+    optional sinks that are only referenced through pointers.
+*/
+struct SineWaveSound : public juce::SynthesiserSound
+{
+    SineWaveSound() {}
+
+    bool appliesToNote(int) override { return true; }
+    bool appliesToChannel(int) override { return true; }
+};
+
+//==============================================================================
+// The JI frequencies and grid layout every note is built from. May be written
+// from one thread at a time; the synth picks up changes at the start of each block.
+// The three frequencies are published together behind a sequence counter, so a
+// reader never sees the bass of one tuning with the melody of another.
+class JITuning
+{
+public:
+    void store(const TuningValues& newValues);
+
+    // false if a store was in progress on every try; the caller keeps what it had
+    bool tryLoad(TuningValues& values) const;
+
+    std::atomic<const GridLayout*> layout { &GridLayouts::getDefault() };
+
+private:
+    std::atomic<juce::uint32> sequence { 0 };  // odd while a store is in progress
+    std::atomic<double> rootFreq { 0.0 };
+    std::atomic<double> bassFreq { 0.0 };
+    std::atomic<double> melFreq { 0.0 };
+};
+
+//==============================================================================
+struct SineWaveVoice : public juce::SynthesiserVoice
+{
+    // voiceBit is this voice's bit in the synth's active voice mask
+    SineWaveVoice(const NoteFrequencies& frequencies, juce::uint32& activeVoiceMask, juce::uint32 voiceBit);
+
+    bool canPlaySound(juce::SynthesiserSound* sound) override;
+
+    void startNote(int midiNoteNumber, float velocity,
+        juce::SynthesiserSound*, int /*currentPitchWheelPosition*/) override;
+
+    void stopNote(float /*velocity*/, bool allowTailOff) override;
+
+    void pitchWheelMoved(int) override;
+    void controllerMoved(int, int) override;
+
+    void renderNextBlock(juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples) override;
+
+    // the frequency the current note was started with, or 0 when idle
+    double getFrequency() const;
+
+private:
+    void finishNote();
+
+    const NoteFrequencies& noteFrequencies;
+    juce::uint32& activeVoices;
+    const juce::uint32 voiceBit;
+
+    double currentAngle = 0.0, angleDelta = 0.0, level = 0.0, tailOff = 0.0;
+    int tailOffSamplesRemaining = 0;
+    double frequency = 0.0;
+};
+
+//==============================================================================
+// Only renders the voices whose bit is set in the active voice mask, so voices
+// that have finished their tail cost nothing.
+class JISynthesiser : public juce::Synthesiser
+{
+public:
+    juce::uint32 activeVoiceMask = 0;
+
+    bool isIdle() const { return activeVoiceMask == 0; }
+
+protected:
+    using juce::Synthesiser::renderVoices;
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override;
+};
+
+//==============================================================================
+class SynthAudioSource : public juce::AudioSource
+{
+public:
+    static constexpr int numVoices = 4;
+
+    SynthAudioSource(juce::MidiKeyboardState& keyState);
+
+    void setUsingSineWaveSound();
+
+    void prepareToPlay(int /*samplesPerBlockExpected*/, double sampleRate) override;
+
+    void releaseResources() override;
+
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    // renders one block from an already collected MIDI buffer (used by the plug-in and when replaying sessions)
+    void renderBlock(const juce::AudioSourceChannelInfo& bufferToFill, juce::MidiBuffer& midi);
+
+    // from one thread at a time, e.g. the message thread in the app or the audio thread in the plug-in
+    void setJIFrequencies(double newRootFreq, double newBassFreq, double newMelFreq);
+
+    // swaps the layout used by notes started from the next block on
+    void setGridLayout(const GridLayout& newLayout);
+    const GridLayout& getGridLayout() const;
+
+    // true once every voice has finished its tail
+    bool isIdle() const;
+
+    // how long a released note keeps sounding, in samples
+    static int getTailLengthSamples();
+
+    // audio thread, or wherever renderBlock is called: the frequency of the voice
+    // playing this note, or 0 if none is
+    double getVoiceFrequency(int midiNoteNumber) const;
+
+    // the recorder must outlive the audio callback, or be removed before it is deleted
+    void setSessionRecorder(SessionRecorder* recorder);
+
+    // notes are also sent to this output, with the same frequencies the voices use;
+    // it must outlive the audio callback, or be removed before it is deleted
+    void setMPEOutput(MPEOutput* output);
+
+    // turning this off leaves the MPE output as the only sound source: notes still sounding are
+    // released, and the synth idles until it's turned back on
+    void setInternalRenderingEnabled(bool shouldRender);
+
+    juce::MidiMessageCollector* getMidiCollector();
+
+private:
+    void renderSynth(const juce::AudioSourceChannelInfo& bufferToFill, const juce::MidiBuffer& midi);
+    bool updateNoteFrequencies();
+
+    juce::MidiKeyboardState& keyboardState;
+    JITuning tuning;
+
+    // audio thread only: the table the voices read, and what it was built from
+    NoteFrequencies noteFrequencies {};
+    TuningValues currentTuning {};
+    const GridLayout* currentLayout = nullptr;
+
+    JISynthesiser synth;
+    juce::MidiMessageCollector midiCollector;
+    juce::MidiBuffer incomingMidi;
+
+    std::atomic<SessionRecorder*> sessionRecorder { nullptr };
+    std::atomic<MPEOutput*> mpeOutput { nullptr };
+    std::atomic<bool> internalRendering { true };
+    bool wasRendering = true;
+    const juce::MidiBuffer noMidi;
+    SessionRecorder* activeRecorder = nullptr;
+    double currentSampleRate = 0.0;
+    int currentBlockSize = 0;
+};